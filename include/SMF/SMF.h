@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 /// @brief Initialize the SMF context.
@@ -24,6 +25,63 @@ typedef void (*SMF_ErrorCallback)(const char *msg, void *data);
 /// @param data The custom user data (can be NULL) to provide to the callback function.
 void SMF_SetErrorCallback(SMF_ErrorCallback cb, void *data);
 
+/// @brief Type that represents a user provided memory allocation function.
+typedef void *(*SMF_AllocFunc)(size_t size, void *user);
+
+/// @brief Type that represents a user provided memory reallocation function.
+typedef void *(*SMF_ReallocFunc)(void *ptr, size_t size, void *user);
+
+/// @brief Type that represents a user provided memory release function.
+typedef void (*SMF_FreeFunc)(void *ptr, void *user);
+
+/// @brief Set the memory functions used for all allocations made by the library (including those made by SDL).
+/// @param alloc The allocation function (all functions may be NULL to restore the defaults).
+/// @param realloc The reallocation function.
+/// @param free The release function.
+/// @param user The custom user data (can be NULL) to provide to the memory functions.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note This must be called before SMF_Init. The functions must be thread-safe, since SDL and the glyph worker
+/// thread (see SMF_PrewarmGlyphs) also allocate through them.
+int SMF_SetAllocator(SMF_AllocFunc alloc, SMF_ReallocFunc realloc, SMF_FreeFunc free, void *user);
+
+/// @brief Type that describes the subsystem that owns an allocation.
+typedef enum SMF_MemorySubsystem
+{
+    SMF_MEMORY_IMAGE_SURFACES = 0,
+    SMF_MEMORY_GLYPH_SURFACES,
+    SMF_MEMORY_FONT_FACES,
+    SMF_MEMORY_HASH_MAPS,
+    SMF_MEMORY_HANDLE_SETS,
+    SMF_MEMORY_FRAME_ARENA,
+    SMF_MEMORY_GLYPH_METRICS,
+    SMF_MEMORY_DISTANCE_FIELDS,
+    SMF_MEMORY_TEXT_LAYOUTS,
+    SMF_MEMORY_CAPTURE_BUFFERS,
+    SMF_MEMORY_SHAPE_SURFACES,
+    SMF_MEMORY_SUBSYSTEM_COUNT
+} SMF_MemorySubsystem;
+
+/// @brief Memory usage figures for a single subsystem.
+typedef struct SMF_MemoryStat
+{
+    uint64_t current;
+    uint64_t peak;
+    uint64_t allocs;
+    uint64_t frees;
+} SMF_MemoryStat;
+
+/// @brief Memory usage figures for the library.
+typedef struct SMF_MemoryStats
+{
+    SMF_MemoryStat subsystems[SMF_MEMORY_SUBSYSTEM_COUNT];
+    uint64_t handle_set_used;
+} SMF_MemoryStats;
+
+/// @brief Retrieve the current memory usage of the library broken down by subsystem.
+/// @param stats The memory statistics to fill out (handle_set_used is the part of the handle set capacity in use).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_GetMemoryStats(SMF_MemoryStats *stats);
+
 /// @brief Set the desired window size in pixels.
 /// @param w The width in pixels of the window drawing area.
 /// @param h The height in pixels of the window drawing area.
@@ -68,6 +126,37 @@ typedef uint64_t SMF_Handle;
 /// @return A valid handle for the image or SMF_INVALID_HANDLE for an error (see SMF_GetError).
 SMF_Handle SMF_LoadImage(const char *path);
 
+/// @brief Load an image from a buffer in memory and return a unique handle to it.
+/// @param data The encoded image data (only needs to stay valid for the duration of the call).
+/// @param size The size in bytes of the encoded image data.
+/// @return A valid handle for the image or SMF_INVALID_HANDLE for an error (see SMF_GetError).
+SMF_Handle SMF_LoadImageFromMemory(const void *data, size_t size);
+
+#define SMF_SEEK_SET 0
+#define SMF_SEEK_CUR 1
+#define SMF_SEEK_END 2
+
+/// @brief Set of user provided callbacks that a resource is read from.
+typedef struct SMF_Stream
+{
+    /// @brief The custom user data (can be NULL) to provide to the callbacks.
+    void *user;
+    /// @brief Retrieve the total size in bytes of the stream (may be NULL if unknown), -1 for an error.
+    int64_t (*size)(void *user);
+    /// @brief Seek to an offset relative to SMF_SEEK_SET, SMF_SEEK_CUR or SMF_SEEK_END and return the new position,
+    /// -1 for an error.
+    int64_t (*seek)(void *user, int64_t offset, int whence);
+    /// @brief Read up to size bytes into ptr and return the number of bytes read (0 at the end of the stream).
+    size_t (*read)(void *user, void *ptr, size_t size);
+    /// @brief Called once the stream is no longer needed (may be NULL).
+    void (*close)(void *user);
+} SMF_Stream;
+
+/// @brief Load an image from a user provided stream and return a unique handle to it.
+/// @param stream The stream to read the encoded image from (closed before returning).
+/// @return A valid handle for the image or SMF_INVALID_HANDLE for an error (see SMF_GetError).
+SMF_Handle SMF_LoadImageFromStream(const SMF_Stream *stream);
+
 /// @brief Definition for a sub-image that is loaded from a larger image.
 typedef struct SMF_ImageDef
 {
@@ -83,6 +172,23 @@ typedef struct SMF_ImageDef
 /// @return 0 for success, -1 for an error (see SMF_GetError).
 int SMF_LoadImageSet(const char *path, int count, const SMF_ImageDef *defs, SMF_Handle *handles);
 
+/// @brief Load a set of images from a single image in a buffer in memory and return unique handles to them
+/// @param data The encoded image data (only needs to stay valid for the duration of the call).
+/// @param size The size in bytes of the encoded image data.
+/// @param count The number of individual images to extract from the image.
+/// @param defs The image definitions to load from the image.
+/// @param handles An array of handles that are set for each image that was loaded.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_LoadImageSetFromMemory(const void *data, size_t size, int count, const SMF_ImageDef *defs, SMF_Handle *handles);
+
+/// @brief Load a set of images from a single image in a user provided stream and return unique handles to them
+/// @param stream The stream to read the encoded image from (closed before returning).
+/// @param count The number of individual images to extract from the image.
+/// @param defs The image definitions to load from the image.
+/// @param handles An array of handles that are set for each image that was loaded.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_LoadImageSetFromStream(const SMF_Stream *stream, int count, const SMF_ImageDef *defs, SMF_Handle *handles);
+
 /// @brief Retrieve the size of a loaded image resource.
 /// @param image Handle to the image resource.
 /// @param x The x dimension to retrieve (may be NULL).
@@ -90,12 +196,66 @@ int SMF_LoadImageSet(const char *path, int count, const SMF_ImageDef *defs, SMF_
 /// @return 0 for success, -1 for an error (see SMF_GetError).
 int SMF_GetImageSize(SMF_Handle image, int *w, int *h);
 
-/// @brief Load a TrueType font from the filesystem at a given size.
-/// @param path The path to the font file to load.
+/// @brief Create an image that rendering commands can be redirected into (see SMF_SetRenderTarget).
+/// @param w Width in pixels of the image.
+/// @param h Height in pixels of the image.
+/// @return A valid handle for the image or SMF_INVALID_HANDLE for an error (see SMF_GetError).
+/// @note The image starts out transparent and keeps its contents between frames, so it can be rendered once and
+/// drawn with SMF_RenderImage every frame. Some renderers lose the contents of every render target (e.g. when the
+/// Direct3D device is reset), which is reported by a SMF_EVENT_TYPE_RENDER_TARGETS_RESET event after which the
+/// image has to be rendered again.
+SMF_Handle SMF_CreateRenderTarget(int w, int h);
+
+/// @brief Load a TrueType font from the filesystem at a given size (glyphs are rasterized on first use).
+/// @param path The path to the font file to load (loading the same path at another size shares the file data).
 /// @param ttf_size The point size to load the font as.
 /// @return A valid handle for the font or SMF_INVALID_HANDLE for an error (see SMF_GetError).
 SMF_Handle SMF_LoadTrueTypeFont(const char *path, int ttf_size);
 
+/// @brief Load a TrueType font from a buffer in memory at a given size.
+/// @param data The font file data (read in place, so it must stay valid until SMF_Quit).
+/// @param size The size in bytes of the font file data.
+/// @param ttf_size The point size to load the font as.
+/// @return A valid handle for the font or SMF_INVALID_HANDLE for an error (see SMF_GetError).
+SMF_Handle SMF_LoadTrueTypeFontFromMemory(const void *data, size_t size, int ttf_size);
+
+/// @brief Load a TrueType font from a user provided stream at a given size.
+/// @param stream The stream to read the font file from (read on demand and closed at SMF_Quit, or before returning
+/// on failure).
+/// @param ttf_size The point size to load the font as.
+/// @return A valid handle for the font or SMF_INVALID_HANDLE for an error (see SMF_GetError).
+SMF_Handle SMF_LoadTrueTypeFontFromStream(const SMF_Stream *stream, int ttf_size);
+
+/// @brief Load a TrueType font from the filesystem as a signed distance field font that can be rendered at any size.
+/// @param path The path to the font file to load.
+/// @param reference_size The point size glyphs are rasterized at once before being stored as distance fields.
+/// @return A valid handle for the font or SMF_INVALID_HANDLE for an error (see SMF_GetError).
+/// @note Sizes up to about twice the reference size keep sharp outlines, the font renders at the reference size until
+/// SMF_SetFontSize is called.
+SMF_Handle SMF_LoadSDFFont(const char *path, int reference_size);
+
+/// @brief Set the size that text is measured and rendered at for a signed distance field font.
+/// @param font Handle to the font resource (must be loaded with SMF_LoadSDFFont).
+/// @param size The point size to render at.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_SetFontSize(SMF_Handle font, int size);
+
+/// @brief Statistics for the font files shared by TrueType fonts loaded from the filesystem.
+typedef struct SMF_FontFileStats
+{
+    uint64_t files;
+    uint64_t faces;
+    uint64_t shared_faces;
+    uint64_t mapped_bytes;
+    uint64_t resident_bytes;
+} SMF_FontFileStats;
+
+/// @brief Retrieve statistics for the font files opened by SMF_LoadTrueTypeFont and SMF_LoadSDFFont.
+/// @param stats The font file statistics to fill out (shared_faces counts the faces that reuse an open file).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note resident_bytes is the part of the mapped files currently in physical memory where the platform reports it.
+int SMF_GetFontFileStats(SMF_FontFileStats *stats);
+
 /// @brief Definition for a font glyph image for a bitmap font.
 typedef struct SMF_GlyphDef
 {
@@ -134,14 +294,107 @@ int SMF_FontContainsGlyph(SMF_Handle font, uint32_t glyph);
 /// @param font Handle to the font resource.
 /// @param glyph The glyph to retrieve the image for.
 /// @return A valid handle for the image or SMF_INVALID_HANDLE for an error (see SMF_GetError).
+/// @note Non-ASCII glyphs of TrueType fonts live in the glyph cache, so the handle may become invalid after the frame
+/// it was retrieved in (see SMF_SetGlyphCacheBudget).
 SMF_Handle SMF_GetFontGlyphImage(SMF_Handle font, uint32_t glyph);
 
+/// @brief Metrics of a single glyph in a font (in pixels, with y going up from the baseline).
+typedef struct SMF_GlyphInfo
+{
+    int advance;
+    int min_x, max_x;
+    int min_y, max_y;
+} SMF_GlyphInfo;
+
+/// @brief Retrieve the metrics of a particular glyph in a font.
+/// @param font Handle to the font resource.
+/// @param glyph The glyph to retrieve the metrics for.
+/// @param info The metrics to fill out (all 0 if the font does not contain the glyph).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_GetFontGlyphMetrics(SMF_Handle font, uint32_t glyph, SMF_GlyphInfo *info);
+
+/// @brief Enable or disable kerning between pairs of glyphs when measuring and rendering text.
+/// @param font Handle to the font resource.
+/// @param enabled 1 to enable kerning, 0 to disable it (default, and bitmap fonts are never kerned).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_SetFontKerning(SMF_Handle font, int enabled);
+
+/// @brief Set the maximum number of bytes used by glyphs rasterized on demand from TrueType fonts.
+/// @param bytes The budget in bytes (0 means no limit, which is the default).
+/// @note Least recently used glyphs are evicted when over budget and rasterized again when needed. Bitmap font
+/// glyphs and the ASCII glyphs of TrueType fonts are never evicted.
+void SMF_SetGlyphCacheBudget(size_t bytes);
+
+/// @brief Statistics for the glyph cache.
+typedef struct SMF_GlyphCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t size;
+    uint64_t budget;
+} SMF_GlyphCacheStats;
+
+/// @brief Retrieve the statistics for the glyph cache.
+/// @param stats The statistics to fill out.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_GetGlyphCacheStats(SMF_GlyphCacheStats *stats);
+
+/// @brief Inclusive range of glyphs.
+typedef struct SMF_GlyphRange
+{
+    uint32_t first;
+    uint32_t last;
+} SMF_GlyphRange;
+
+/// @brief Rasterize glyphs of a TrueType font on a background thread so they are ready before they are first used.
+/// @param font Handle to the font resource.
+/// @param ranges The ranges of glyphs to rasterize (glyphs the font does not provide are skipped).
+/// @param count The number of ranges.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note Glyphs are published as they finish (at the latest on the next SMF_RenderPresent), and glyphs outside of ASCII
+/// are subject to the glyph cache budget like any other.
+int SMF_PrewarmGlyphs(SMF_Handle font, const SMF_GlyphRange *ranges, int count);
+
 /// @brief Calculate the width in pixels for a string of text rendered in a font.
 /// @param font Handle to the font resource.
-/// @param text The text string to calculate the width for.
+/// @param text The UTF-8 text string to calculate the width for.
 /// @return A positive (or 0) integer for the retrieved width, -1 for an error (see SMF_GetError).
 int SMF_CalcTextWidth(SMF_Handle font, const char *text);
 
+/// @brief Calculate the width in pixels for a string of text of a known length rendered in a font.
+/// @param font Handle to the font resource.
+/// @param text The UTF-8 text to calculate the width for (does not need to be null terminated).
+/// @param len The length of the text in bytes.
+/// @return A positive (or 0) integer for the retrieved width, -1 for an error (see SMF_GetError).
+int SMF_CalcTextWidthN(SMF_Handle font, const char *text, size_t len);
+
+/// @brief Wrap text into lines that fit a width, breaking at spaces, hyphens, between ideographs and at newlines.
+/// @param font Handle to the font resource to measure the text with.
+/// @param text The UTF-8 text to lay out (copied into the layout).
+/// @param max_width The maximum width in pixels of a line (0 or less only breaks at newlines).
+/// @param out_layout Receives the handle to the new layout resource.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_LayoutText(SMF_Handle font, const char *text, int max_width, SMF_Handle *out_layout);
+
+/// @brief Lay out the edited text of a layout again, only re-wrapping the lines affected by the edit.
+/// @param layout Handle to the layout resource.
+/// @param text The complete UTF-8 text after the edit.
+/// @param edit_offset The byte offset of the first change (the text before it must be unchanged).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_UpdateLayout(SMF_Handle layout, const char *text, size_t edit_offset);
+
+/// @brief Retrieve the size in pixels of laid out text.
+/// @param layout Handle to the layout resource.
+/// @param w The width of the widest line (may be NULL).
+/// @param h The height of all lines (may be NULL).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_GetLayoutSize(SMF_Handle layout, int *w, int *h);
+
+/// @brief Destroy a layout resource.
+/// @param layout Handle to the layout resource.
+void SMF_DestroyLayout(SMF_Handle layout);
+
 /// @brief Retrieve the current render output (taking into account scaling).
 /// @param w The width in pixels of the render output (may be NULL).
 /// @param h The height in pixels of the render output (may be NULL).
@@ -152,11 +405,136 @@ int SMF_GetRenderSize(int *w, int *h);
 /// @return 0 for success, -1 for an error (see SMF_GetError).
 int SMF_RenderPresent(void);
 
+/// @brief Type that describes the file format of a frame capture.
+typedef enum SMF_CaptureFormat
+{
+    SMF_CAPTURE_FORMAT_Y4M = 1,
+    SMF_CAPTURE_FORMAT_RAW_BGRA
+} SMF_CaptureFormat;
+
+/// @brief Frame counts of the current (or last) frame capture and the count of failed screenshots.
+typedef struct SMF_CaptureStats
+{
+    uint64_t frames_captured;
+    uint64_t frames_written;
+    uint64_t frames_dropped;
+    /// @brief Screenshots that could not be written (counted across captures, not reset when one starts).
+    uint64_t screenshots_failed;
+} SMF_CaptureStats;
+
+/// @brief Start streaming every presented frame to a file.
+/// @param path The path of the file to write (an existing file is replaced).
+/// @param format The file format (Y4M video at the display refresh rate, or headerless BGRA frames of the render output
+/// size).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note Frames are written by a background thread. Frames that arrive while the writer is behind are dropped (and
+/// counted) instead of delaying SMF_RenderPresent.
+int SMF_StartCapture(const char *path, SMF_CaptureFormat format);
+
+/// @brief Stop the frame capture, waiting for the frames already captured to be written.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_StopCapture(void);
+
+/// @brief Save the next presented frame as a PNG image.
+/// @param path The path of the image to write (an existing file is replaced).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note The image is written by a background thread after the next SMF_RenderPresent, a failure to write it is only
+/// counted in SMF_CaptureStats::screenshots_failed.
+int SMF_SaveScreenshot(const char *path);
+
+/// @brief Retrieve the frame counts of the current (or last) frame capture.
+/// @param stats The frame counts to fill out.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_GetCaptureStats(SMF_CaptureStats *stats);
+
+#define SMF_SHARED_FRAME_MAGIC 0x534d4653u
+#define SMF_SHARED_FRAME_VERSION 1
+#define SMF_SHARED_FRAME_SLOTS 3
+
+/// @brief Mask of the slot index in SMF_SharedFrameHeader::state.
+#define SMF_SHARED_FRAME_SLOT_MASK 0x3u
+
+/// @brief Flag in SMF_SharedFrameHeader::state that is set while the slot it holds has a frame not yet taken.
+#define SMF_SHARED_FRAME_FRESH 0x4u
+
+/// @brief Type that describes the pixel format of shared frames.
+typedef enum SMF_SharedFrameFormat
+{
+    SMF_SHARED_FRAME_FORMAT_BGRA = 1
+} SMF_SharedFrameFormat;
+
+/// @brief Header at the start of the shared memory written by SMF_StartSharedFrameOutput.
+/// @note The frames are a triple buffer: the producer writes one slot, the consumer reads another and the third one
+/// is exchanged through state. A consumer starts out owning slot 2 and takes a new frame by atomically exchanging
+/// state with the slot it owns whenever SMF_SHARED_FRAME_FRESH is set (the slot that comes back is its new frame,
+/// which the producer does not touch until it is exchanged again). futex is incremented with every frame (and when
+/// the output stops) and can be waited on with a shared futex on Linux.
+typedef struct SMF_SharedFrameHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t format;
+    uint64_t slot_offset[SMF_SHARED_FRAME_SLOTS];
+    uint64_t slot_seq[SMF_SHARED_FRAME_SLOTS];
+    uint64_t seq;
+    uint32_t state;
+    uint32_t futex;
+    uint32_t is_active;
+} SMF_SharedFrameHeader;
+
+/// @brief Start writing every presented frame into POSIX shared memory for another process to read.
+/// @param name The name of the shared memory object (such as "/smf-frames").
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note The shared memory starts with a SMF_SharedFrameHeader and each slot begins on a page boundary. Frames of a
+/// different size than the render output at the time of the call are skipped. Not supported on Windows.
+int SMF_StartSharedFrameOutput(const char *name);
+
+/// @brief Stop the shared frame output and remove the shared memory object.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_StopSharedFrameOutput(void);
+
+/// @brief Type that represents a rectangle.
+typedef struct SMF_Rect
+{
+    int x, y;
+    int w, h;
+} SMF_Rect;
+
+/// @brief Type that represents a point.
+typedef struct SMF_Point
+{
+    int x, y;
+} SMF_Point;
+
 /// @brief Set the drawing color for future rendering commands.
 /// @param color The color to set.
 /// @return 0 for success, -1 for an error (see SMF_GetError).
 int SMF_SetRenderColor(SMF_Color color);
 
+/// @brief Type that describes how rendering commands combine with the pixels already drawn.
+/// @note NONE replaces the pixels (alpha included), ALPHA blends with the alpha of the source, PREMULTIPLIED blends a
+/// source whose colors are already multiplied by its alpha, ADD adds the source and MULTIPLY multiplies the pixels by
+/// the source (both weighted by the alpha of the source).
+typedef enum SMF_BlendMode
+{
+    SMF_BLEND_MODE_NONE = 0,
+    SMF_BLEND_MODE_ALPHA,
+    SMF_BLEND_MODE_PREMULTIPLIED,
+    SMF_BLEND_MODE_ADD,
+    SMF_BLEND_MODE_MULTIPLY
+} SMF_BlendMode;
+
+/// @brief Set the blend mode for future rendering commands.
+/// @param mode The blend mode to set.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note Like the rendering color, the blend mode goes back to SMF_BLEND_MODE_ALPHA after each SMF_RenderPresent. Text
+/// grids are always alpha blended. Opaque images drawn with SMF_BLEND_MODE_ALPHA and an opaque color are copied
+/// without blending.
+int SMF_SetRenderBlendMode(SMF_BlendMode mode);
+
 /// @brief Render an image (tinted with the rendering color).
 /// @param image Handle to the image resource.
 /// @param x X position on the window to draw the image at.
@@ -164,6 +542,50 @@ int SMF_SetRenderColor(SMF_Color color);
 /// @return 0 for success, -1 for an error (see SMF_GetError).
 int SMF_RenderImage(SMF_Handle image, int x, int y);
 
+/// @brief Type that describes how an image is mirrored by SMF_RenderImageEx.
+typedef enum SMF_Flip
+{
+    SMF_FLIP_NONE = 0,
+    SMF_FLIP_HORIZONTAL = 1,
+    SMF_FLIP_VERTICAL = 2
+} SMF_Flip;
+
+/// @brief Render an image scaled, rotated and/or flipped (tinted with the rendering color).
+/// @param image Handle to the image resource.
+/// @param dst_rect The rectangle on the window to stretch the image over.
+/// @param angle The clockwise rotation in degrees.
+/// @param pivot The point (relative to dst_rect) to rotate around, or NULL for the center of dst_rect.
+/// @param flip The mirroring to apply (SMF_FLIP_HORIZONTAL and SMF_FLIP_VERTICAL can be combined).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note Images scaled by a whole factor without rotation keep sharp pixels, other cases are filtered.
+int SMF_RenderImageEx(SMF_Handle image, const SMF_Rect *dst_rect, double angle, const SMF_Point *pivot, SMF_Flip flip);
+
+/// @brief Type that represents the widths of the borders of a nine-slice image.
+typedef struct SMF_Insets
+{
+    int left, top;
+    int right, bottom;
+} SMF_Insets;
+
+/// @brief Create a nine-slice panel from an image whose borders stay the same size when the panel is stretched.
+/// @param image Handle to the image resource (it must outlive the nine-slice).
+/// @param insets The widths of the left, top, right and bottom borders of the image.
+/// @return A valid handle for the nine-slice or SMF_INVALID_HANDLE for an error (see SMF_GetError).
+/// @note The corners are drawn as is, the edges are stretched along their length and the center in both directions.
+SMF_Handle SMF_CreateNineSlice(SMF_Handle image, const SMF_Insets *insets);
+
+/// @brief Render a nine-slice panel (tinted with the rendering color).
+/// @param nine_slice Handle to the nine-slice resource.
+/// @param rect The rectangle on the window to fill with the panel.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note The last few sizes drawn in more than one frame are kept fully expanded, so drawing a panel at one of them
+/// is a single image copy. Borders shrink proportionally when the panel is smaller than they are.
+int SMF_RenderNineSlice(SMF_Handle nine_slice, const SMF_Rect *rect);
+
+/// @brief Destroy a nine-slice resource (along with the panels it keeps expanded).
+/// @param nine_slice Handle to the nine-slice resource.
+void SMF_DestroyNineSlice(SMF_Handle nine_slice);
+
 /// @brief Render the glyph of a font (tinted with the rendering color).
 /// @param font Handle to the font resource.
 /// @param glyph Glyph index to render.
@@ -174,12 +596,88 @@ int SMF_RenderGlyph(SMF_Handle font, uint32_t glyph, int x, int y);
 
 /// @brief Render a string of text (tinted with the rendering color).
 /// @param font Handle to the font resource.
-/// @param text String of text to render.
+/// @param text UTF-8 string of text to render.
 /// @param x X position on the window to start rendering at.
 /// @param y Y position on the window to start rendering at.
 /// @return 0 for sucess, -1 for an error (see SMF_GetError).
 int SMF_RenderText(SMF_Handle font, const char *text, int x, int y);
 
+/// @brief Render a string of text of a known length (tinted with the rendering color).
+/// @param font Handle to the font resource.
+/// @param text UTF-8 text to render (does not need to be null terminated).
+/// @param len The length of the text in bytes.
+/// @param x X position on the window to start rendering at.
+/// @param y Y position on the window to start rendering at.
+/// @return 0 for sucess, -1 for an error (see SMF_GetError).
+int SMF_RenderTextN(SMF_Handle font, const char *text, size_t len, int x, int y);
+
+/// @brief Render laid out text at a location in the window.
+/// @param layout Handle to the layout resource.
+/// @param x The x location in pixels of the first line.
+/// @param y The y location in pixels of the first line.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_RenderLayout(SMF_Handle layout, int x, int y);
+
+/// @brief Create a grid of character cells for terminal-style output (best suited to fixed-width fonts).
+/// @param font Handle to the font resource to draw the cells with.
+/// @param cols The number of columns in the grid.
+/// @param rows The number of rows in the grid.
+/// @return A valid handle for the text grid or SMF_INVALID_HANDLE for an error (see SMF_GetError).
+/// @note The cells start out as spaces on a transparent background.
+SMF_Handle SMF_CreateTextGrid(SMF_Handle font, int cols, int rows);
+
+/// @brief Retrieve the size in pixels of a single cell of a text grid.
+/// @param grid Handle to the text grid resource.
+/// @param w The width of a cell (may be NULL).
+/// @param h The height of a cell (may be NULL).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_GetTextGridCellSize(SMF_Handle grid, int *w, int *h);
+
+/// @brief Set a single cell of a text grid.
+/// @param grid Handle to the text grid resource.
+/// @param col The column of the cell.
+/// @param row The row of the cell.
+/// @param glyph The glyph to show in the cell (glyphs larger than a cell are cut off).
+/// @param fg The color of the glyph.
+/// @param bg The color of the cell background.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_PutTextGridCell(SMF_Handle grid, int col, int row, uint32_t glyph, SMF_Color fg, SMF_Color bg);
+
+/// @brief Set consecutive cells of a row in a text grid to the glyphs of a string.
+/// @param grid Handle to the text grid resource.
+/// @param col The column of the first cell.
+/// @param row The row of the cells.
+/// @param text The UTF-8 text to place one glyph per cell (cut off at the end of the row).
+/// @param fg The color of the glyphs.
+/// @param bg The color of the cell backgrounds.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_PutTextGridString(SMF_Handle grid, int col, int row, const char *text, SMF_Color fg, SMF_Color bg);
+
+/// @brief Set every cell of a text grid to a space.
+/// @param grid Handle to the text grid resource.
+/// @param bg The color of the cell backgrounds.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_ClearTextGrid(SMF_Handle grid, SMF_Color bg);
+
+/// @brief Scroll the rows of a text grid, filling the rows that come into view with spaces.
+/// @param grid Handle to the text grid resource.
+/// @param rows The number of rows to scroll by (positive moves the content up, negative moves it down).
+/// @param bg The color of the cell backgrounds of the new rows.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_ScrollTextGrid(SMF_Handle grid, int rows, SMF_Color bg);
+
+/// @brief Render a text grid at a location in the window.
+/// @param grid Handle to the text grid resource.
+/// @param x The x location in pixels.
+/// @param y The y location in pixels.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note Only the cells that changed since the grid was last rendered are drawn again.
+int SMF_RenderTextGrid(SMF_Handle grid, int x, int y);
+
+/// @brief Destroy a text grid resource.
+/// @param grid Handle to the text grid resource.
+void SMF_DestroyTextGrid(SMF_Handle grid);
+
 /// @brief Render a filled rectangle (tinted with the rendering color).
 /// @param x X position on the window for the upper-left corner of the rectangle.
 /// @param y Y position on the window for the upper-left corner of the rectangle.
@@ -188,6 +686,53 @@ int SMF_RenderText(SMF_Handle font, const char *text, int x, int y);
 /// @return 0 for success, -1 for an error (see SMF_GetError).
 int SMF_RenderFillRect(int x, int y, int w, int h);
 
+/// @brief Render a batch of filled rectangles (tinted with the rendering color).
+/// @param count The number of rectangles.
+/// @param rects The rectangles to fill.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note Rectangles are cut down to the clipping rectangle (or the render target) when they are recorded, so a batch
+/// only costs as much as its visible part.
+int SMF_RenderFillRects(int count, const SMF_Rect *rects);
+
+/// @brief Render a batch of rectangle outlines (tinted with the rendering color).
+/// @param count The number of rectangles.
+/// @param rects The rectangles to outline.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_RenderRects(int count, const SMF_Rect *rects);
+
+/// @brief Render connected line segments (tinted with the rendering color).
+/// @param count The number of points (a line needs at least 2).
+/// @param points The points to connect, each one is joined to the next one.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_RenderLines(int count, const SMF_Point *points);
+
+/// @brief Render an anti-aliased filled circle (tinted with the rendering color).
+/// @param cx The horizontal coordinate of the center.
+/// @param cy The vertical coordinate of the center.
+/// @param radius The radius (up to 2048).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note Shapes are rasterized once per size and cached as coverage, so they batch with images and glyphs.
+int SMF_RenderFillCircle(int cx, int cy, int radius);
+
+/// @brief Render an anti-aliased filled rectangle with rounded corners (tinted with the rendering color).
+/// @param x The horizontal coordinate.
+/// @param y The vertical coordinate.
+/// @param w The width (up to 4096).
+/// @param h The height (up to 4096).
+/// @param radius The radius of the corners (limited to half the smallest side).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_RenderFillRoundedRect(int x, int y, int w, int h, int radius);
+
+/// @brief Render an anti-aliased line of any thickness (tinted with the rendering color).
+/// @param x1 The horizontal coordinate of the first point.
+/// @param y1 The vertical coordinate of the first point.
+/// @param x2 The horizontal coordinate of the second point.
+/// @param y2 The vertical coordinate of the second point.
+/// @param thickness The thickness (up to 4096).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note The ends are squared off by half the thickness past each point.
+int SMF_RenderThickLine(int x1, int y1, int x2, int y2, int thickness);
+
 /// @brief Set a clipping rectangle for future rendering commands.
 /// @param x X position on the window for the upper-left corner of the clipping rectangle.
 /// @param y Y position on the window for the upper-left corner of the clipping rectangle.
@@ -200,6 +745,19 @@ int SMF_SetRenderClipRect(int x, int y, int w, int h);
 /// @return 0 for success, -1 for an error (see SMF_GetError).
 int SMF_ClearRenderClipRect(void);
 
+/// @brief Redirect future rendering commands into a render target.
+/// @param image Handle to an image created with SMF_CreateRenderTarget, or SMF_INVALID_HANDLE to render to the window.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note Switching targets clears the clipping rectangle, and every frame starts out rendering to the window. Drawing a
+/// render target while it is the current target fails, and commands sent to a target that is destroyed before
+/// SMF_RenderPresent are dropped.
+int SMF_SetRenderTarget(SMF_Handle image);
+
+/// @brief Fill the whole current render target with the current render color (replacing its contents, alpha
+/// included).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_RenderClear(void);
+
 /// @brief Type that represents supported mouse buttons.
 typedef enum SMF_MouseButton
 {
@@ -239,7 +797,9 @@ typedef enum SMF_EventType
     SMF_EVENT_TYPE_MOUSE_SCROLL,
     SMF_EVENT_TYPE_KEY_DOWN,
     SMF_EVENT_TYPE_KEY_UP,
-    SMF_EVENT_TYPE_TEXT_INPUT
+    SMF_EVENT_TYPE_TEXT_INPUT,
+    SMF_EVENT_TYPE_USER,
+    SMF_EVENT_TYPE_RENDER_TARGETS_RESET
 } SMF_EventType;
 
 /// @brief Type that represents a single event.
@@ -255,6 +815,7 @@ typedef struct SMF_Event
         struct
         {
             int x, y;
+            int dx, dy;
         } mouse_move;
         struct
         {
@@ -280,6 +841,11 @@ typedef struct SMF_Event
         {
             char text[32];
         } text_input;
+        struct
+        {
+            int code;
+            void *payload;
+        } user;
     };
 } SMF_Event;
 
@@ -288,6 +854,99 @@ typedef struct SMF_Event
 /// @return 0 if no event was processed, 1 if an event was processed, -1 for an error (see SMF_GetError).
 int SMF_PollEvent(SMF_Event *event);
 
+/// @brief Poll for all queued events at once.
+/// @param buf The buffer to fill out with the processed events.
+/// @param cap The maximum number of events the buffer can hold.
+/// @return The number of events processed (0 if there were none), -1 for an error (see SMF_GetError).
+/// @note Events that do not fit into the buffer are left queued for the next call.
+int SMF_PollEvents(SMF_Event *buf, int cap);
+
+/// @brief Wait for the next event, blocking until one arrives or the timeout expires.
+/// @param event The event information to fill out if an event was processed.
+/// @param milliseconds The maximum time to wait (negative waits without a timeout).
+/// @return 0 if the timeout expired without an event, 1 if an event was processed, -1 for an error (see SMF_GetError).
+int SMF_WaitEventTimeout(SMF_Event *event, int milliseconds);
+
+/// @brief Queue a SMF_EVENT_TYPE_USER event and wake up a thread waiting in SMF_WaitEventTimeout.
+/// @param code Application defined code for the event.
+/// @param payload Application defined data for the event (can be NULL, it is handed over as is).
+/// @return 0 for success, -1 if the library is not initialized, -2 if the queue is full.
+/// @note This is safe to call from any thread, which is why failures are only reported through the return value and
+/// leave SMF_GetError untouched. User events are returned ahead of other pending events and the queue holds up to
+/// 1024 events that have not been polled yet.
+int SMF_PushUserEvent(int code, void *payload);
+
+/// @brief Enable or disable merging consecutive mouse move events into a single event.
+/// @param enabled 1 to merge mouse moves (the merged event has the latest position and the summed deltas), 0 to
+/// receive every mouse move (the default).
+void SMF_SetMouseMotionCoalescing(int enabled);
+
+/// @brief Check if a key is currently held down.
+/// @param key The key to check.
+/// @return 1 if the key is down, 0 otherwise.
+/// @note The input state is refreshed whenever events are polled (SMF_PollEvent refreshes it once the queue is empty).
+int SMF_IsKeyDown(SMF_Key key);
+
+/// @brief Check if a key was pressed during the current frame.
+/// @param key The key to check.
+/// @return 1 if the key went down since the last SMF_RenderPresent, 0 otherwise.
+int SMF_IsKeyPressed(SMF_Key key);
+
+/// @brief Check if a mouse button is currently held down.
+/// @param button The mouse button to check.
+/// @return 1 if the button is down, 0 otherwise.
+int SMF_IsMouseButtonDown(SMF_MouseButton button);
+
+/// @brief Check if a mouse button was pressed during the current frame.
+/// @param button The mouse button to check.
+/// @return 1 if the button went down since the last SMF_RenderPresent, 0 otherwise.
+int SMF_IsMouseButtonPressed(SMF_MouseButton button);
+
+/// @brief Retrieve the current mouse position.
+/// @param x The X position of the mouse (can be NULL).
+/// @param y The Y position of the mouse (can be NULL).
+void SMF_GetMousePosition(int *x, int *y);
+
+/// @brief Retrieve the scroll accumulated during the current frame.
+/// @param x The accumulated horizontal scroll (can be NULL).
+/// @param y The accumulated vertical scroll (can be NULL).
+void SMF_GetMouseScroll(int *x, int *y);
+
+/// @brief Frame time figures of an input replay (in microseconds).
+typedef struct SMF_ReplayStats
+{
+    uint64_t frames;
+    uint64_t mean_us;
+    uint64_t p50_us;
+    uint64_t p95_us;
+    uint64_t p99_us;
+    uint64_t max_us;
+} SMF_ReplayStats;
+
+/// @brief Start recording every event returned by the event functions (and every presented frame) into a log.
+/// @param path The path of the log file to write (an existing file is replaced).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note The recording stops with SMF_StopInputRecording or SMF_Quit.
+int SMF_StartInputRecording(const char *path);
+
+/// @brief Stop recording events.
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_StopInputRecording(void);
+
+/// @brief Replay a log written by SMF_StartInputRecording instead of processing real input.
+/// @param path The path of the log file to replay.
+/// @param report_path The path of the frame time report written by SMF_Quit (can be NULL for no report).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+/// @note This must be called before SMF_Init. The replay runs offscreen on the SDL dummy video driver, hands out the
+/// recorded events frame by frame and drives SMF_GetTicks from the recorded times (SMF_Sleep returns immediately).
+/// Once the log runs out a SMF_EVENT_TYPE_QUIT event is returned.
+int SMF_StartInputReplay(const char *path, const char *report_path);
+
+/// @brief Retrieve the frame time figures of the current replay.
+/// @param stats The frame time figures to fill out (all zero when there is no replay).
+/// @return 0 for success, -1 for an error (see SMF_GetError).
+int SMF_GetReplayStats(SMF_ReplayStats *stats);
+
 /// @brief Sleep for a specified amount of time.
 /// @param milliseconds Number of milliseconds to sleep for.
 void SMF_Sleep(int milliseconds);
@@ -0,0 +1,580 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_capture.h"
+
+#include "SMF_context.h"
+#include "SMF_mem.h"
+#include "SMF_window.h"
+
+// the number of frames that can wait for the writer before new frames get dropped
+#define SMF_CAPTURE_RING_SIZE 4
+
+#define SMF_CAPTURE_DEFAULT_FPS 60
+
+typedef struct SMF_CaptureSlot
+{
+    uint8_t *pixels;
+    int is_video;
+    char *screenshot_path;
+} SMF_CaptureSlot;
+
+static SDL_Thread *g_thread = NULL;
+static SDL_mutex *g_lock = NULL;
+static SDL_cond *g_cond = NULL;
+static int g_quit = 0;
+
+// the ring is filled by the thread presenting frames and drained in order by the writer, the slots between tail and
+// head belong to the writer and every other slot to the presenting thread (both counters are guarded by g_lock)
+static SMF_CaptureSlot g_ring[SMF_CAPTURE_RING_SIZE];
+static int g_ring_w = 0;
+static int g_ring_h = 0;
+static uint64_t g_head = 0;
+static uint64_t g_tail = 0;
+
+static int g_is_capturing = 0;
+static SMF_CaptureFormat g_format;
+static FILE *g_file = NULL;
+static uint8_t *g_yuv = NULL;
+static size_t g_yuv_size = 0;
+static char *g_screenshot_path = NULL;
+
+static SMF_CaptureStats g_stats;
+static int g_write_failed = 0;
+
+static size_t GetFrameSize(void)
+{
+    return (size_t)g_ring_w * (size_t)g_ring_h * 4;
+}
+
+// full range BT.601 (what the C420jpeg color space of Y4M expects) with the chroma averaged over 2x2 pixels
+static void ConvertToI420(const uint8_t *pixels, int w, int h, uint8_t *yuv)
+{
+    int cw = (w + 1) / 2;
+    int ch = (h + 1) / 2;
+    uint8_t *y_plane = yuv;
+    uint8_t *u_plane = yuv + (size_t)w * h;
+    uint8_t *v_plane = u_plane + (size_t)cw * ch;
+
+    for (int y = 0; y < h; ++y)
+    {
+        const uint8_t *row = pixels + (size_t)y * w * 4;
+        for (int x = 0; x < w; ++x)
+        {
+            int b = row[x * 4 + 0];
+            int g = row[x * 4 + 1];
+            int r = row[x * 4 + 2];
+            y_plane[(size_t)y * w + x] = (uint8_t)((77 * r + 150 * g + 29 * b + 128) >> 8);
+        }
+    }
+
+    for (int cy = 0; cy < ch; ++cy)
+    {
+        int y0 = cy * 2;
+        int y1 = y0 + 1 < h ? y0 + 1 : y0;
+        const uint8_t *row0 = pixels + (size_t)y0 * w * 4;
+        const uint8_t *row1 = pixels + (size_t)y1 * w * 4;
+        for (int cx = 0; cx < cw; ++cx)
+        {
+            int x0 = cx * 2 * 4;
+            int x1 = cx * 2 + 1 < w ? x0 + 4 : x0;
+            int b = row0[x0 + 0] + row0[x1 + 0] + row1[x0 + 0] + row1[x1 + 0];
+            int g = row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1];
+            int r = row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2];
+
+            // the sums are four times the average, which the shift by 10 instead of 8 takes care of
+            u_plane[(size_t)cy * cw + cx] = (uint8_t)(((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128);
+            v_plane[(size_t)cy * cw + cx] = (uint8_t)(((128 * r - 107 * g - 21 * b + 512) >> 10) + 128);
+        }
+    }
+}
+
+static int WriteVideoFrame(const uint8_t *pixels)
+{
+    if (g_format == SMF_CAPTURE_FORMAT_RAW_BGRA)
+    {
+        return fwrite(pixels, 1, GetFrameSize(), g_file) == GetFrameSize() ? 0 : -1;
+    }
+
+    ConvertToI420(pixels, g_ring_w, g_ring_h, g_yuv);
+    if (fputs("FRAME\n", g_file) == EOF)
+    {
+        return -1;
+    }
+
+    return fwrite(g_yuv, 1, g_yuv_size, g_file) == g_yuv_size ? 0 : -1;
+}
+
+static int WriteScreenshot(uint8_t *pixels, const char *path)
+{
+    // the back buffer does not necessarily have a meaningful alpha channel
+    size_t count = (size_t)g_ring_w * g_ring_h;
+    for (size_t ix = 0; ix < count; ++ix)
+    {
+        pixels[ix * 4 + 3] = 255;
+    }
+
+    SDL_Surface *surface =
+        SDL_CreateRGBSurfaceWithFormatFrom(pixels, g_ring_w, g_ring_h, 32, g_ring_w * 4, SDL_PIXELFORMAT_BGRA32);
+    if (!surface)
+    {
+        return -1;
+    }
+
+    int result = IMG_SavePNG(surface, path);
+    SDL_FreeSurface(surface);
+
+    return result == 0 ? 0 : -1;
+}
+
+static int SDLCALL WriterMain(void *data)
+{
+    SDL_LockMutex(g_lock);
+    while (!g_quit || g_tail != g_head)
+    {
+        if (g_tail == g_head)
+        {
+            SDL_CondWait(g_cond, g_lock);
+            continue;
+        }
+
+        SMF_CaptureSlot *slot = g_ring + g_tail % SMF_CAPTURE_RING_SIZE;
+        SDL_UnlockMutex(g_lock);
+
+        // the video frame goes first because the screenshot overwrites the alpha channel
+        int result = 0;
+        if (slot->is_video)
+        {
+            result = WriteVideoFrame(slot->pixels);
+        }
+
+        int screenshot_result = 0;
+        if (slot->screenshot_path)
+        {
+            screenshot_result = WriteScreenshot(slot->pixels, slot->screenshot_path);
+            SMF_Free(slot->screenshot_path);
+            slot->screenshot_path = NULL;
+        }
+
+        SDL_LockMutex(g_lock);
+        if (screenshot_result == -1)
+        {
+            g_stats.screenshots_failed++;
+        }
+
+        if (slot->is_video)
+        {
+            if (result == 0)
+            {
+                g_stats.frames_written++;
+            }
+            else
+            {
+                g_write_failed = 1;
+            }
+        }
+
+        g_tail++;
+        SDL_CondBroadcast(g_cond);
+    }
+    SDL_UnlockMutex(g_lock);
+
+    return 0;
+}
+
+static int StartWriter(void)
+{
+    g_lock = SDL_CreateMutex();
+    g_cond = SDL_CreateCond();
+    if (!g_lock || !g_cond)
+    {
+        SMF_SDLError();
+        SMF_CleanCapture();
+        return -1;
+    }
+
+    g_quit = 0;
+
+    g_thread = SDL_CreateThread(WriterMain, "SMF_CaptureWriter", NULL);
+    if (!g_thread)
+    {
+        SMF_SDLError();
+        SMF_CleanCapture();
+        return -1;
+    }
+
+    return 0;
+}
+
+static void FreeRing(void)
+{
+    for (int ix = 0; ix < SMF_CAPTURE_RING_SIZE; ++ix)
+    {
+        if (g_ring[ix].pixels)
+        {
+            SMF_TrackFree(SMF_MEMORY_CAPTURE_BUFFERS, GetFrameSize());
+            SMF_Free(g_ring[ix].pixels);
+            g_ring[ix].pixels = NULL;
+        }
+    }
+
+    g_ring_w = 0;
+    g_ring_h = 0;
+}
+
+// (re)allocates the ring for frames of the given size, which is only done while the writer has nothing to work on
+static int PrepareRing(int w, int h)
+{
+    if (g_ring_w == w && g_ring_h == h)
+    {
+        return 0;
+    }
+
+    SDL_LockMutex(g_lock);
+    int is_idle = g_tail == g_head;
+    SDL_UnlockMutex(g_lock);
+    if (!is_idle)
+    {
+        return SMF_SetError("capture writer is busy");
+    }
+
+    FreeRing();
+
+    size_t size = (size_t)w * (size_t)h * 4;
+    for (int ix = 0; ix < SMF_CAPTURE_RING_SIZE; ++ix)
+    {
+        g_ring[ix].pixels = SMF_Calloc(size, 1);
+        if (!g_ring[ix].pixels)
+        {
+            for (int jx = 0; jx < ix; ++jx)
+            {
+                SMF_TrackFree(SMF_MEMORY_CAPTURE_BUFFERS, size);
+                SMF_Free(g_ring[jx].pixels);
+                g_ring[jx].pixels = NULL;
+            }
+            return -1;
+        }
+
+        SMF_TrackAlloc(SMF_MEMORY_CAPTURE_BUFFERS, size);
+    }
+
+    g_ring_w = w;
+    g_ring_h = h;
+
+    return 0;
+}
+
+void SMF_CaptureFrame(SDL_Renderer *renderer)
+{
+    if (!g_is_capturing && !g_screenshot_path)
+    {
+        return;
+    }
+
+    int w = 0;
+    int h = 0;
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+
+    // a screenshot can resize the ring (when no capture holds on to it), a capture keeps the size it started with
+    if (!g_is_capturing && PrepareRing(w, h) == -1)
+    {
+        return;
+    }
+
+    SDL_LockMutex(g_lock);
+    int is_full = g_head - g_tail == SMF_CAPTURE_RING_SIZE;
+    SDL_UnlockMutex(g_lock);
+
+    // dropping a frame is the only option that never stalls the presenting thread (a pending screenshot simply
+    // waits for the next frame)
+    if (is_full || w != g_ring_w || h != g_ring_h)
+    {
+        if (g_is_capturing)
+        {
+            g_stats.frames_dropped++;
+        }
+        return;
+    }
+
+    SMF_CaptureSlot *slot = g_ring + g_head % SMF_CAPTURE_RING_SIZE;
+    if (SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_BGRA32, slot->pixels, w * 4) == -1)
+    {
+        if (g_is_capturing)
+        {
+            g_stats.frames_dropped++;
+        }
+        return;
+    }
+
+    slot->is_video = g_is_capturing;
+    slot->screenshot_path = g_screenshot_path;
+    g_screenshot_path = NULL;
+
+    if (g_is_capturing)
+    {
+        g_stats.frames_captured++;
+    }
+
+    SDL_LockMutex(g_lock);
+    g_head++;
+    SDL_CondBroadcast(g_cond);
+    SDL_UnlockMutex(g_lock);
+}
+
+static int GetRefreshRate(void)
+{
+    SDL_DisplayMode mode;
+    SDL_Window *window = SDL_RenderGetWindow(SMF_GetRenderer());
+    int display = window ? SDL_GetWindowDisplayIndex(window) : -1;
+    if (display < 0 || SDL_GetCurrentDisplayMode(display, &mode) == -1 || mode.refresh_rate <= 0)
+    {
+        return SMF_CAPTURE_DEFAULT_FPS;
+    }
+
+    return mode.refresh_rate;
+}
+
+int SMF_StartCapture(const char *path, SMF_CaptureFormat format)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    if (!path)
+    {
+        return SMF_InvalidArgError("path");
+    }
+
+    if (format != SMF_CAPTURE_FORMAT_Y4M && format != SMF_CAPTURE_FORMAT_RAW_BGRA)
+    {
+        return SMF_InvalidArgError("format");
+    }
+
+    if (g_is_capturing)
+    {
+        return SMF_SetError("capture already started");
+    }
+
+    if (!g_thread && StartWriter() == -1)
+    {
+        return -1;
+    }
+
+    int w = 0;
+    int h = 0;
+    if (SDL_GetRendererOutputSize(SMF_GetRenderer(), &w, &h) == -1)
+    {
+        return SMF_SDLError();
+    }
+
+    // a pending screenshot has to be written before the ring can be resized
+    SDL_LockMutex(g_lock);
+    while (g_tail != g_head)
+    {
+        SDL_CondWait(g_cond, g_lock);
+    }
+    SDL_UnlockMutex(g_lock);
+
+    if (PrepareRing(w, h) == -1)
+    {
+        return -1;
+    }
+
+    if (format == SMF_CAPTURE_FORMAT_Y4M)
+    {
+        size_t yuv_size = (size_t)w * h + (size_t)((w + 1) / 2) * ((h + 1) / 2) * 2;
+        if (yuv_size != g_yuv_size)
+        {
+            uint8_t *yuv = SMF_Calloc(yuv_size, 1);
+            if (!yuv)
+            {
+                return -1;
+            }
+
+            if (g_yuv)
+            {
+                SMF_TrackFree(SMF_MEMORY_CAPTURE_BUFFERS, g_yuv_size);
+                SMF_Free(g_yuv);
+            }
+
+            SMF_TrackAlloc(SMF_MEMORY_CAPTURE_BUFFERS, yuv_size);
+            g_yuv = yuv;
+            g_yuv_size = yuv_size;
+        }
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        return SMF_SetError("failed to open '%s' for writing", path);
+    }
+
+    if (format == SMF_CAPTURE_FORMAT_Y4M &&
+        fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", w, h, GetRefreshRate()) < 0)
+    {
+        fclose(file);
+        return SMF_SetError("failed to write to '%s'", path);
+    }
+
+    g_file = file;
+    g_format = format;
+    g_write_failed = 0;
+    // screenshots are not part of a capture, so their failures keep counting across captures
+    uint64_t screenshots_failed = g_stats.screenshots_failed;
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_stats.screenshots_failed = screenshots_failed;
+    g_is_capturing = 1;
+
+    return 0;
+}
+
+int SMF_StopCapture(void)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!g_is_capturing)
+    {
+        return 0;
+    }
+
+    g_is_capturing = 0;
+
+    // the frames already handed to the writer are still written out
+    SDL_LockMutex(g_lock);
+    while (g_tail != g_head)
+    {
+        SDL_CondWait(g_cond, g_lock);
+    }
+    int write_failed = g_write_failed;
+    SDL_UnlockMutex(g_lock);
+
+    int result = fclose(g_file);
+    g_file = NULL;
+
+    if (write_failed || result != 0)
+    {
+        return SMF_SetError("failed to write the capture");
+    }
+
+    return 0;
+}
+
+int SMF_SaveScreenshot(const char *path)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    if (!path)
+    {
+        return SMF_InvalidArgError("path");
+    }
+
+    if (!g_thread && StartWriter() == -1)
+    {
+        return -1;
+    }
+
+    size_t len = strlen(path);
+    char *copy = SMF_Calloc(len + 1, 1);
+    if (!copy)
+    {
+        return -1;
+    }
+
+    memcpy(copy, path, len);
+
+    // only the latest request is kept when several come in before the next frame
+    SMF_Free(g_screenshot_path);
+    g_screenshot_path = copy;
+
+    return 0;
+}
+
+int SMF_GetCaptureStats(SMF_CaptureStats *stats)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!stats)
+    {
+        return SMF_InvalidArgError("stats");
+    }
+
+    if (!g_lock)
+    {
+        memset(stats, 0, sizeof(SMF_CaptureStats));
+        return 0;
+    }
+
+    SDL_LockMutex(g_lock);
+    *stats = g_stats;
+    SDL_UnlockMutex(g_lock);
+
+    return 0;
+}
+
+void SMF_CleanCapture(void)
+{
+    if (g_lock)
+    {
+        SMF_StopCapture();
+    }
+
+    if (g_thread)
+    {
+        SDL_LockMutex(g_lock);
+        g_quit = 1;
+        SDL_CondBroadcast(g_cond);
+        SDL_UnlockMutex(g_lock);
+
+        SDL_WaitThread(g_thread, NULL);
+        g_thread = NULL;
+    }
+
+    FreeRing();
+    g_head = 0;
+    g_tail = 0;
+
+    if (g_yuv)
+    {
+        SMF_TrackFree(SMF_MEMORY_CAPTURE_BUFFERS, g_yuv_size);
+        SMF_Free(g_yuv);
+        g_yuv = NULL;
+        g_yuv_size = 0;
+    }
+
+    SMF_Free(g_screenshot_path);
+    g_screenshot_path = NULL;
+
+    SDL_DestroyCond(g_cond);
+    SDL_DestroyMutex(g_lock);
+    g_cond = NULL;
+    g_lock = NULL;
+}
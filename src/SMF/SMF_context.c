@@ -12,8 +12,18 @@
 
 #include "SMF_context.h"
 
+#include "SMF_capture.h"
+#include "SMF_event.h"
 #include "SMF_font.h"
 #include "SMF_image.h"
+#include "SMF_layout.h"
+#include "SMF_mem.h"
+#include "SMF_nine_slice.h"
+#include "SMF_render.h"
+#include "SMF_replay.h"
+#include "SMF_shape.h"
+#include "SMF_shared_frame.h"
+#include "SMF_text_grid.h"
 #include "SMF_window.h"
 
 #define SMF_ERROR_BUF_SIZE 256
@@ -41,8 +51,16 @@ int SMF_Init(void)
         return SMF_SDLError();
     }
 
+    if (SMF_InitEvents() == -1)
+    {
+        TTF_Quit();
+        SDL_Quit();
+        return -1;
+    }
+
     if (SMF_InitImages() == -1)
     {
+        SMF_CleanEvents();
         TTF_Quit();
         SDL_Quit();
         return -1;
@@ -51,6 +69,40 @@ int SMF_Init(void)
     if (SMF_InitFonts() == -1)
     {
         SMF_CleanImages();
+        SMF_CleanEvents();
+        TTF_Quit();
+        SDL_Quit();
+        return -1;
+    }
+
+    if (SMF_InitLayouts() == -1)
+    {
+        SMF_CleanFonts();
+        SMF_CleanImages();
+        SMF_CleanEvents();
+        TTF_Quit();
+        SDL_Quit();
+        return -1;
+    }
+
+    if (SMF_InitTextGrids() == -1)
+    {
+        SMF_CleanLayouts();
+        SMF_CleanFonts();
+        SMF_CleanImages();
+        SMF_CleanEvents();
+        TTF_Quit();
+        SDL_Quit();
+        return -1;
+    }
+
+    if (SMF_InitNineSlices() == -1)
+    {
+        SMF_CleanTextGrids();
+        SMF_CleanLayouts();
+        SMF_CleanFonts();
+        SMF_CleanImages();
+        SMF_CleanEvents();
         TTF_Quit();
         SDL_Quit();
         return -1;
@@ -68,9 +120,19 @@ void SMF_Quit(void)
         return;
     }
 
+    SMF_CleanRender();
+    SMF_CleanCapture();
+    SMF_CleanSharedFrames();
+    SMF_CleanNineSlices();
+    SMF_CleanTextGrids();
+    SMF_CleanLayouts();
     SMF_CleanFonts();
+    SMF_CleanShapes();
     SMF_CleanImages();
     SMF_CleanupWindow();
+    SMF_CleanFrameArena();
+    SMF_CleanReplay();
+    SMF_CleanEvents();
 
     TTF_Quit();
     SDL_Quit();
@@ -133,3 +195,14 @@ int SMF_IsInitialized(void)
 
     return 0;
 }
+
+int SMF_IsNotInitialized(void)
+{
+    if (g_initialized == 1)
+    {
+        SMF_SetError("library already initialized");
+        return -1;
+    }
+
+    return 0;
+}
@@ -9,3 +9,4 @@ int SMF_InvalidArgError(const char *arg);
 int SMF_SDLError(void);
 
 int SMF_IsInitialized(void);
+int SMF_IsNotInitialized(void);
@@ -5,11 +5,91 @@
 
 #include "SMF/SMF.h"
 
+#include "SMF_event.h"
+
 #include "SMF_context.h"
+#include "SMF_input.h"
+#include "SMF_nine_slice.h"
+#include "SMF_replay.h"
+#include "SMF_text_grid.h"
 #include "SMF_window.h"
 
+#define SMF_EVENT_BATCH_SIZE 64
+
+// the capacity of the user event queue (must be a power of two)
+#define SMF_USER_EVENT_QUEUE_SIZE 1024
+
 static int g_is_event_saved = 0;
 static SMF_Event g_saved_event;
+static int g_coalesce_motion = 0;
+
+// a bounded lock-free queue where every cell carries a sequence number that tells producers when the cell is free
+// and the consumer when it is filled (any thread can push, only the thread polling events pops)
+typedef struct SMF_UserEventCell
+{
+    SDL_atomic_t seq;
+    int code;
+    void *payload;
+} SMF_UserEventCell;
+
+static SMF_UserEventCell g_user_cells[SMF_USER_EVENT_QUEUE_SIZE];
+static SDL_atomic_t g_user_push_pos;
+static unsigned g_user_pop_pos = 0;
+
+// the SDL event that wakes a blocked wait, only one is queued at a time so a burst of pushes costs a single wake
+static Uint32 g_user_sdl_event = (Uint32)-1;
+static SDL_atomic_t g_user_wake_pending;
+
+// set while the queue can take events, pushes read this instead of SMF_IsInitialized since they can run on any
+// thread and must not touch the error state of the main thread
+static SDL_atomic_t g_user_events_ready;
+
+int SMF_InitEvents(void)
+{
+    g_user_sdl_event = SDL_RegisterEvents(1);
+    if (g_user_sdl_event == (Uint32)-1)
+    {
+        return SMF_SetError("failed to register the user event");
+    }
+
+    for (unsigned ix = 0; ix < SMF_USER_EVENT_QUEUE_SIZE; ++ix)
+    {
+        SDL_AtomicSet(&g_user_cells[ix].seq, (int)ix);
+    }
+
+    SDL_AtomicSet(&g_user_push_pos, 0);
+    g_user_pop_pos = 0;
+    SDL_AtomicSet(&g_user_wake_pending, 0);
+    SDL_AtomicSet(&g_user_events_ready, 1);
+
+    return 0;
+}
+
+void SMF_CleanEvents(void)
+{
+    SDL_AtomicSet(&g_user_events_ready, 0);
+    g_is_event_saved = 0;
+    g_user_sdl_event = (Uint32)-1;
+}
+
+static int PopUserEvent(SMF_Event *event)
+{
+    SMF_UserEventCell *cell = g_user_cells + (g_user_pop_pos & (SMF_USER_EVENT_QUEUE_SIZE - 1));
+    if ((int)((unsigned)SDL_AtomicGet(&cell->seq) - (g_user_pop_pos + 1)) < 0)
+    {
+        return 0;
+    }
+
+    event->type = SMF_EVENT_TYPE_USER;
+    event->user.code = cell->code;
+    event->user.payload = cell->payload;
+
+    // hand the cell back to the producers for the next lap around the queue
+    SDL_AtomicSet(&cell->seq, (int)(g_user_pop_pos + SMF_USER_EVENT_QUEUE_SIZE));
+    g_user_pop_pos++;
+
+    return 1;
+}
 
 static int MapMouseButton(int sdl_button, SMF_MouseButton *out)
 {
@@ -53,23 +133,142 @@ static SMF_KeyMod MapKeyModifiers(int mods)
     return out;
 }
 
-int SMF_PollEvent(SMF_Event *event)
+// folds the motion events queued right behind a motion event into it (the latest position with the summed deltas)
+static void CoalesceMotion(SDL_Event *e)
 {
-    if (SMF_IsInitialized() == -1)
+    SDL_Event next;
+    while (SDL_PeepEvents(&next, 1, SDL_PEEKEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT) == 1 &&
+           next.type == SDL_MOUSEMOTION)
     {
-        return -1;
+        SDL_PeepEvents(&next, 1, SDL_GETEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION);
+        next.motion.xrel += e->motion.xrel;
+        next.motion.yrel += e->motion.yrel;
+        *e = next;
     }
+}
 
-    if (SMF_IsWindowCreated() == -1)
+// events are in the unscaled coordinates of the render output, once the renderer has a logical size SDL maps mouse
+// events into it by itself and only window coordinates without one need scaling here
+static int GetEventScale(void)
+{
+    int w = 0;
+    SDL_Renderer *renderer = SMF_GetRenderer();
+    if (renderer)
     {
-        return -1;
+        SDL_RenderGetLogicalSize(renderer, &w, NULL);
     }
 
-    if (!event)
+    return w == 0 ? SMF_GetWindowScale() : 1;
+}
+
+static int TranslateEvent(const SDL_Event *e, SMF_Event *event)
+{
+    int scale = GetEventScale();
+
+    SMF_TrackInputEvent(e);
+
+    if (e->type == g_user_sdl_event)
     {
-        return SMF_InvalidArgError("event");
+        // clearing the flag before popping means a push racing with this either lands in the pop or queues a new wake
+        SDL_AtomicSet(&g_user_wake_pending, 0);
+        return PopUserEvent(event);
+    }
+
+    switch (e->type)
+    {
+    case SDL_WINDOWEVENT:
+        switch (e->window.event)
+        {
+        case SDL_WINDOWEVENT_CLOSE:
+            event->type = SMF_EVENT_TYPE_QUIT;
+            return 1;
+        case SDL_WINDOWEVENT_FOCUS_LOST:
+            event->type = SMF_EVENT_TYPE_LOST_FOCUS;
+            return 1;
+        case SDL_WINDOWEVENT_FOCUS_GAINED:
+            event->type = SMF_EVENT_TYPE_GOT_FOCUS;
+            return 1;
+        case SDL_WINDOWEVENT_LEAVE:
+            event->type = SMF_EVENT_TYPE_MOUSE_LEAVE;
+            return 1;
+        case SDL_WINDOWEVENT_ENTER: {
+            int x = 0;
+            int y = 0;
+            // the mouse state is never mapped by SDL, so it always comes in window coordinates
+            SDL_GetMouseState(&x, &y);
+            x /= SMF_GetWindowScale();
+            y /= SMF_GetWindowScale();
+            event->type = SMF_EVENT_TYPE_MOUSE_ENTER;
+            event->mouse_enter.x = x;
+            event->mouse_enter.y = y;
+            return 1;
+        }
+        default:
+            break;
+        }
+        break;
+    case SDL_MOUSEMOTION:
+        event->type = SMF_EVENT_TYPE_MOUSE_MOVE;
+        event->mouse_move.x = e->motion.x / scale;
+        event->mouse_move.y = e->motion.y / scale;
+        event->mouse_move.dx = e->motion.xrel / scale;
+        event->mouse_move.dy = e->motion.yrel / scale;
+        return 1;
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+        if (MapMouseButton(e->button.button, &event->mouse_button.button) == 0)
+        {
+            event->type = e->type == SDL_MOUSEBUTTONDOWN ? SMF_EVENT_TYPE_MOUSE_PRESS : SMF_EVENT_TYPE_MOUSE_RELEASE;
+            event->mouse_button.x = e->button.x / scale;
+            event->mouse_button.y = e->button.y / scale;
+
+            if (e->type == SDL_MOUSEBUTTONDOWN)
+            {
+                g_is_event_saved = 1;
+                g_saved_event.type =
+                    e->button.clicks % 2 == 0 ? SMF_EVENT_TYPE_MOUSE_DOUBLE_CLICK : SMF_EVENT_TYPE_MOUSE_CLICK;
+                g_saved_event.mouse_click.button = event->mouse_button.button;
+                g_saved_event.mouse_click.x = event->mouse_button.x;
+                g_saved_event.mouse_click.y = event->mouse_button.y;
+            }
+
+            return 1;
+        }
+        break;
+    case SDL_MOUSEWHEEL:
+        event->type = SMF_EVENT_TYPE_MOUSE_SCROLL;
+        event->mouse_scroll.x = e->wheel.mouseX / scale;
+        event->mouse_scroll.y = e->wheel.mouseY / scale;
+        event->mouse_scroll.scroll_x = e->wheel.x;
+        event->mouse_scroll.scroll_y = e->wheel.y;
+        return 1;
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+        event->type = e->type == SDL_KEYDOWN ? SMF_EVENT_TYPE_KEY_DOWN : SMF_EVENT_TYPE_KEY_UP;
+        event->key.key = (SMF_Key)e->key.keysym.sym;
+        event->key.mods = MapKeyModifiers(e->key.keysym.mod);
+        return 1;
+    case SDL_TEXTINPUT:
+        event->type = SMF_EVENT_TYPE_TEXT_INPUT;
+        memcpy(event->text_input.text, e->text.text, sizeof(event->text_input.text));
+        return 1;
+    case SDL_RENDER_TARGETS_RESET:
+    case SDL_RENDER_DEVICE_RESET:
+        // render targets lost their contents, the text grids and nine-slices rebuild their own and the application
+        // is told so it can redraw the rest
+        SMF_InvalidateTextGrids();
+        SMF_InvalidateNineSlices();
+        event->type = SMF_EVENT_TYPE_RENDER_TARGETS_RESET;
+        return 1;
+    default:
+        break;
     }
 
+    return 0;
+}
+
+static int PollEvent(SMF_Event *event)
+{
     if (g_is_event_saved)
     {
         *event = g_saved_event;
@@ -80,95 +279,327 @@ int SMF_PollEvent(SMF_Event *event)
     SDL_Event e;
     while (SDL_PollEvent(&e))
     {
-        switch (e.type)
+        if (g_coalesce_motion && e.type == SDL_MOUSEMOTION)
+        {
+            CoalesceMotion(&e);
+        }
+
+        if (TranslateEvent(&e, event))
         {
-        case SDL_WINDOWEVENT:
-            switch (e.window.event)
-            {
-            case SDL_WINDOWEVENT_CLOSE:
-                event->type = SMF_EVENT_TYPE_QUIT;
-                return 1;
-            case SDL_WINDOWEVENT_FOCUS_LOST:
-                event->type = SMF_EVENT_TYPE_LOST_FOCUS;
-                return 1;
-            case SDL_WINDOWEVENT_FOCUS_GAINED:
-                event->type = SMF_EVENT_TYPE_GOT_FOCUS;
-                return 1;
-            case SDL_WINDOWEVENT_LEAVE:
-                event->type = SMF_EVENT_TYPE_MOUSE_LEAVE;
-                return 1;
-            case SDL_WINDOWEVENT_ENTER: {
-                int scale = SMF_GetWindowScale();
-                int x = 0;
-                int y = 0;
-                SDL_GetMouseState(&x, &y);
-                x /= scale;
-                y /= scale;
-                event->type = SMF_EVENT_TYPE_MOUSE_ENTER;
-                event->mouse_enter.x = x;
-                event->mouse_enter.y = y;
-                return 1;
-            }
-            default:
-                break;
-            }
-        case SDL_MOUSEMOTION:
-            event->type = SMF_EVENT_TYPE_MOUSE_MOVE;
-            event->mouse_move.x = e.motion.x;
-            event->mouse_move.y = e.motion.y;
             return 1;
-        case SDL_MOUSEBUTTONDOWN:
-        case SDL_MOUSEBUTTONUP:
-            if (MapMouseButton(e.button.button, &event->mouse_button.button) == 0)
+        }
+    }
+
+    // the queue was drained, so the SDL keyboard and mouse state is as current as it gets
+    SMF_UpdateInputState();
+
+    return 0;
+}
+
+static int PollEvents(SMF_Event *buf, int cap)
+{
+    int count = 0;
+    if (g_is_event_saved)
+    {
+        buf[count++] = g_saved_event;
+        g_is_event_saved = 0;
+    }
+
+    SDL_PumpEvents();
+    SMF_UpdateInputState();
+
+    // a single SDL event can turn into two events (a press followed by a click), so only as many SDL events are
+    // taken from the queue as are certain to fit and a click that does not fit waits for the next call
+    SDL_Event events[SMF_EVENT_BATCH_SIZE];
+    while (count < cap && !g_is_event_saved)
+    {
+        int want = (cap - count) / 2;
+        want = want < 1 ? 1 : (want > SMF_EVENT_BATCH_SIZE ? SMF_EVENT_BATCH_SIZE : want);
+
+        int n = SDL_PeepEvents(events, want, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+        if (n < 0)
+        {
+            return SMF_SDLError();
+        }
+
+        if (n == 0)
+        {
+            break;
+        }
+
+        for (int ix = 0; ix < n; ++ix)
+        {
+            if (g_coalesce_motion && events[ix].type == SDL_MOUSEMOTION)
             {
-                event->type = e.type == SDL_MOUSEBUTTONDOWN ? SMF_EVENT_TYPE_MOUSE_PRESS : SMF_EVENT_TYPE_MOUSE_RELEASE;
-                event->mouse_move.x = e.button.x;
-                event->mouse_move.y = e.button.y;
+                // a run of motion events ends up as its last one, which also absorbs the motion still queued
+                if (ix + 1 < n && events[ix + 1].type == SDL_MOUSEMOTION)
+                {
+                    events[ix + 1].motion.xrel += events[ix].motion.xrel;
+                    events[ix + 1].motion.yrel += events[ix].motion.yrel;
+                    continue;
+                }
 
-                if (e.type == SDL_MOUSEBUTTONDOWN)
+                if (ix + 1 == n)
                 {
-                    g_is_event_saved = 1;
-                    g_saved_event.type =
-                        e.button.clicks % 2 == 0 ? SMF_EVENT_TYPE_MOUSE_DOUBLE_CLICK : SMF_EVENT_TYPE_MOUSE_CLICK;
-                    g_saved_event.mouse_click.button = event->mouse_button.button;
-                    g_saved_event.mouse_click.x = e.button.x;
-                    g_saved_event.mouse_click.y = e.button.y;
+                    CoalesceMotion(events + ix);
                 }
+            }
 
-                return 1;
+            if (TranslateEvent(events + ix, buf + count))
+            {
+                count++;
             }
-            break;
-        case SDL_MOUSEWHEEL:
-            event->type = SMF_EVENT_TYPE_MOUSE_SCROLL;
-            event->mouse_scroll.x = e.wheel.mouseX;
-            event->mouse_scroll.y = e.wheel.mouseY;
-            event->mouse_scroll.scroll_x = e.wheel.x;
-            event->mouse_scroll.scroll_y = e.wheel.y;
-            return 1;
-        case SDL_KEYDOWN:
-        case SDL_KEYUP:
-            event->type = e.type == SDL_KEYDOWN ? SMF_EVENT_TYPE_KEY_DOWN : SMF_EVENT_TYPE_KEY_UP;
-            event->key.key = (SMF_Key)e.key.keysym.sym;
-            event->key.mods = MapKeyModifiers(e.key.keysym.mod);
-            return 1;
-        case SDL_TEXTINPUT:
-            event->type = SMF_EVENT_TYPE_TEXT_INPUT;
-            memcpy(event->text_input.text, e.text.text, sizeof(event->text_input.text));
+
+            if (g_is_event_saved && count < cap)
+            {
+                buf[count++] = g_saved_event;
+                g_is_event_saved = 0;
+            }
+        }
+    }
+
+    return count;
+}
+
+static int WaitEvent(SMF_Event *event, int milliseconds)
+{
+    if (g_is_event_saved)
+    {
+        *event = g_saved_event;
+        g_is_event_saved = 0;
+        return 1;
+    }
+
+    uint64_t deadline = SDL_GetTicks64() + (milliseconds > 0 ? (uint64_t)milliseconds : 0);
+
+    // SDL events that do not translate into an event (such as window moves) keep waiting until the deadline
+    for (;;)
+    {
+        SDL_Event e;
+        if (milliseconds < 0)
+        {
+            if (!SDL_WaitEvent(&e))
+            {
+                return SMF_SDLError();
+            }
+        }
+        else
+        {
+            uint64_t now = SDL_GetTicks64();
+            int remaining = now < deadline ? (int)(deadline - now) : 0;
+            if (!SDL_WaitEventTimeout(&e, remaining))
+            {
+                SMF_UpdateInputState();
+                return 0;
+            }
+        }
+
+        SMF_UpdateInputState();
+
+        if (g_coalesce_motion && e.type == SDL_MOUSEMOTION)
+        {
+            CoalesceMotion(&e);
+        }
+
+        if (TranslateEvent(&e, event))
+        {
             return 1;
-        default:
-            break;
+        }
+    }
+}
+
+int SMF_PollEvent(SMF_Event *event)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    if (!event)
+    {
+        return SMF_InvalidArgError("event");
+    }
+
+    if (PopUserEvent(event))
+    {
+        return 1;
+    }
+
+    if (SMF_IsReplaying())
+    {
+        return SMF_ReplayEvent(event);
+    }
+
+    int result = PollEvent(event);
+    SMF_RecordEvents(event, result);
+
+    return result;
+}
+
+int SMF_PollEvents(SMF_Event *buf, int cap)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    if (!buf)
+    {
+        return SMF_InvalidArgError("buf");
+    }
+
+    if (cap <= 0)
+    {
+        return SMF_InvalidArgError("cap");
+    }
+
+    int count = 0;
+    while (count < cap && PopUserEvent(buf + count))
+    {
+        count++;
+    }
+
+    if (SMF_IsReplaying())
+    {
+        while (count < cap && SMF_ReplayEvent(buf + count) == 1)
+        {
+            count++;
+        }
+
+        return count;
+    }
+
+    if (count == cap)
+    {
+        return count;
+    }
+
+    int polled = PollEvents(buf + count, cap - count);
+    if (polled == -1)
+    {
+        return -1;
+    }
+
+    SMF_RecordEvents(buf + count, polled);
+
+    return count + polled;
+}
+
+int SMF_WaitEventTimeout(SMF_Event *event, int milliseconds)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    if (!event)
+    {
+        return SMF_InvalidArgError("event");
+    }
+
+    if (PopUserEvent(event))
+    {
+        return 1;
+    }
+
+    // a replay never blocks, waiting only makes sense for the real clock
+    if (SMF_IsReplaying())
+    {
+        return SMF_ReplayEvent(event);
+    }
+
+    int result = WaitEvent(event, milliseconds);
+    SMF_RecordEvents(event, result);
+
+    return result;
+}
+
+int SMF_PushUserEvent(int code, void *payload)
+{
+    if (!SDL_AtomicGet(&g_user_events_ready))
+    {
+        return -1;
+    }
+
+    unsigned pos = (unsigned)SDL_AtomicGet(&g_user_push_pos);
+    SMF_UserEventCell *cell = NULL;
+    for (;;)
+    {
+        cell = g_user_cells + (pos & (SMF_USER_EVENT_QUEUE_SIZE - 1));
+        int diff = (int)((unsigned)SDL_AtomicGet(&cell->seq) - pos);
+        if (diff == 0)
+        {
+            if (SDL_AtomicCAS(&g_user_push_pos, (int)pos, (int)(pos + 1)))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return -2;
+        }
+
+        // another producer claimed the cell first
+        pos = (unsigned)SDL_AtomicGet(&g_user_push_pos);
+    }
+
+    cell->code = code;
+    cell->payload = payload;
+    SDL_AtomicSet(&cell->seq, (int)(pos + 1));
+
+    if (SDL_AtomicCAS(&g_user_wake_pending, 0, 1))
+    {
+        SDL_Event e;
+        memset(&e, 0, sizeof(e));
+        e.type = g_user_sdl_event;
+        e.user.code = code;
+        if (SDL_PushEvent(&e) < 0)
+        {
+            // the event itself is queued already, it just gets picked up by the next poll instead of waking a wait
+            SDL_AtomicSet(&g_user_wake_pending, 0);
         }
     }
 
     return 0;
 }
 
+void SMF_SetMouseMotionCoalescing(int enabled)
+{
+    g_coalesce_motion = enabled != 0;
+}
+
 void SMF_Sleep(int milliseconds)
 {
+    // replays run as fast as they can, their time comes from the recording
+    if (SMF_IsReplaying())
+    {
+        return;
+    }
+
     SDL_Delay(milliseconds);
 }
 
 uint64_t SMF_GetTicks(void)
 {
+    if (SMF_IsReplaying())
+    {
+        return SMF_GetReplayTicks();
+    }
+
     return SDL_GetTicks64();
 }
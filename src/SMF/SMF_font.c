@@ -1,6 +1,8 @@
 // Copyright (c) 2024-present, Jason Hoyt
 // Distributed under the MIT License (http://opensource.org/licenses/MIT)
 
+#include <string.h>
+
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
@@ -10,32 +12,154 @@
 #include "SMF_image.h"
 
 #include "SMF_context.h"
+#include "SMF_font.h"
+#include "SMF_font_file.h"
+#include "SMF_glyph_worker.h"
 #include "SMF_handle_set.h"
 #include "SMF_hash_map.h"
+#include "SMF_mem.h"
+#include "SMF_render.h"
+#include "SMF_sdf.h"
+#include "SMF_stream.h"
+#include "SMF_utf8.h"
+#include "SMF_window.h"
+
+// compact metrics of a single glyph (kept separately from the glyph images so that measuring text never rasterizes)
+typedef struct SMF_GlyphMetrics
+{
+    int16_t advance;
+    int16_t min_x;
+    int16_t max_x;
+    int16_t min_y;
+    int16_t max_y;
+} SMF_GlyphMetrics;
+
+// location of the distance field of a glyph in the atlas of a distance field font (an empty field has no image)
+typedef struct SMF_DistanceField
+{
+    uint32_t offset;
+    uint16_t w;
+    uint16_t h;
+} SMF_DistanceField;
 
 typedef struct SMF_Font
 {
     SMF_HandleObject base;
     TTF_Font *ttf;
+    SMF_FontFile *file;
     SMF_Handle ascii_map[95];
+    uint8_t ascii_rasterized[95];
     SMF_HashMap *glyph_map;
+    SMF_GlyphMetrics ascii_metrics[128];
+    SMF_HashMap *metrics_map;
+    SMF_GlyphMetrics *metrics;
+    size_t metrics_len;
+    size_t metrics_cap;
+    SMF_HashMap *kerning_map;
+    int use_kerning;
     int height;
     int is_fixed_width;
     int x_adjust;
+    int is_sdf;
+    int reference_size;
+    int render_size;
+    SMF_HashMap *field_map;
+    SMF_DistanceField *fields;
+    size_t fields_len;
+    size_t fields_cap;
+    uint8_t *atlas;
+    size_t atlas_len;
+    size_t atlas_cap;
 } SMF_Font;
 
+#define IS_ASCII_GLYPH(Glyph) ((Glyph) >= 32 && (Glyph) < 127)
+
+#define INITIAL_METRICS_CAPACITY 64
+
+// cache entry for a glyph rasterized on demand from a TrueType font (these can be evicted and re-rasterized)
+typedef struct SMF_GlyphCacheEntry
+{
+    struct SMF_GlyphCacheEntry *prev;
+    struct SMF_GlyphCacheEntry *next;
+    SMF_Handle font;
+    uint64_t key;
+    SMF_Handle image;
+    size_t size;
+    uint64_t frame;
+} SMF_GlyphCacheEntry;
+
 static SMF_HandleSet g_fonts;
 
+// glyph cache entries of all fonts in least-recently-used order (the head is the most recently used)
+static SMF_GlyphCacheEntry *g_glyph_cache_head = NULL;
+static SMF_GlyphCacheEntry *g_glyph_cache_tail = NULL;
+static size_t g_glyph_cache_size = 0;
+static size_t g_glyph_cache_budget = 0;
+static uint64_t g_glyph_cache_hits = 0;
+static uint64_t g_glyph_cache_misses = 0;
+static uint64_t g_glyph_cache_evictions = 0;
+
+static void DestroyGlyphCacheEntry(SMF_GlyphCacheEntry *entry);
+
 static void DestroyFont(void *data)
 {
     SMF_Font *font = (SMF_Font *)data;
+    if (font->ttf)
+    {
+        // the worker must be done with the face (and the file it reads from) before either goes away
+        SMF_CancelGlyphJobs(font->base.handle);
+
+        SMF_GlyphCacheEntry *entry = g_glyph_cache_head;
+        while (entry)
+        {
+            SMF_GlyphCacheEntry *next = entry->next;
+            if (entry->font == font->base.handle)
+            {
+                DestroyGlyphCacheEntry(entry);
+            }
+            entry = next;
+        }
+    }
     if (font->glyph_map)
     {
         SMF_DestroyHashMap(font->glyph_map);
     }
+    if (font->metrics_map)
+    {
+        SMF_DestroyHashMap(font->metrics_map);
+    }
+    if (font->metrics)
+    {
+        SMF_TrackFree(SMF_MEMORY_GLYPH_METRICS, font->metrics_cap * sizeof(SMF_GlyphMetrics));
+        SMF_Free(font->metrics);
+    }
+    if (font->kerning_map)
+    {
+        SMF_DestroyHashMap(font->kerning_map);
+    }
+    if (font->field_map)
+    {
+        SMF_DestroyHashMap(font->field_map);
+    }
+    if (font->fields)
+    {
+        SMF_TrackFree(SMF_MEMORY_DISTANCE_FIELDS, font->fields_cap * sizeof(SMF_DistanceField));
+        SMF_Free(font->fields);
+    }
+    if (font->atlas)
+    {
+        SMF_TrackFree(SMF_MEMORY_DISTANCE_FIELDS, font->atlas_cap);
+        SMF_Free(font->atlas);
+    }
     if (font->ttf)
     {
+        SMF_LockTTF();
         TTF_CloseFont(font->ttf);
+        SMF_UnlockTTF();
+    }
+    if (font->file)
+    {
+        SMF_ReleaseFontFile(font->file);
     }
 }
 
@@ -46,19 +170,180 @@ int SMF_InitFonts(void)
 
 void SMF_CleanFonts(void)
 {
+    SMF_CleanGlyphWorker();
     SMF_CleanHandleSet(&g_fonts);
 }
 
+static const SMF_GlyphMetrics g_empty_metrics = {0, 0, 0, 0, 0};
+
+static int AddGlyphMetrics(SMF_Font *font, uint32_t glyph, const SMF_GlyphMetrics *metrics)
+{
+    if (glyph < 128)
+    {
+        font->ascii_metrics[glyph] = *metrics;
+        return 0;
+    }
+
+    if (!font->metrics_map)
+    {
+        font->metrics_map = SMF_CreateHashMap();
+        if (!font->metrics_map)
+        {
+            return -1;
+        }
+    }
+
+    if (font->metrics_len == font->metrics_cap)
+    {
+        size_t new_cap = font->metrics_cap == 0 ? INITIAL_METRICS_CAPACITY : font->metrics_cap * 2;
+        SMF_GlyphMetrics *new_metrics = SMF_Calloc(new_cap, sizeof(SMF_GlyphMetrics));
+        if (!new_metrics)
+        {
+            return -1;
+        }
+
+        if (font->metrics)
+        {
+            memcpy(new_metrics, font->metrics, font->metrics_len * sizeof(SMF_GlyphMetrics));
+            SMF_Free(font->metrics);
+            SMF_TrackFree(SMF_MEMORY_GLYPH_METRICS, font->metrics_cap * sizeof(SMF_GlyphMetrics));
+        }
+
+        SMF_TrackAlloc(SMF_MEMORY_GLYPH_METRICS, new_cap * sizeof(SMF_GlyphMetrics));
+
+        font->metrics = new_metrics;
+        font->metrics_cap = new_cap;
+    }
+
+    // the map stores the index into the contiguous metrics array
+    if (SMF_InsertHashMapEntry(font->metrics_map, glyph, (void *)(uintptr_t)font->metrics_len) == -1)
+    {
+        return -1;
+    }
+
+    font->metrics[font->metrics_len] = *metrics;
+    font->metrics_len++;
+
+    return 0;
+}
+
+static int LoadTrueTypeMetrics(SMF_Font *font, uint32_t glyph, SMF_GlyphMetrics *metrics)
+{
+    int min_x = 0;
+    int max_x = 0;
+    int min_y = 0;
+    int max_y = 0;
+    int advance = 0;
+
+    SMF_LockTTF();
+    int result = TTF_GlyphMetrics32(font->ttf, glyph, &min_x, &max_x, &min_y, &max_y, &advance);
+    SMF_UnlockTTF();
+
+    if (result == -1)
+    {
+        return SMF_SDLError();
+    }
+
+    metrics->advance = (int16_t)advance;
+    metrics->min_x = (int16_t)min_x;
+    metrics->max_x = (int16_t)max_x;
+    metrics->min_y = (int16_t)min_y;
+    metrics->max_y = (int16_t)max_y;
+
+    return 0;
+}
+
+static const SMF_GlyphMetrics *GetGlyphMetrics(SMF_Font *font, uint32_t glyph)
+{
+    if (glyph < 128)
+    {
+        return font->ascii_metrics + glyph;
+    }
+
+    void *value = NULL;
+    if (font->metrics_map && SMF_FindHashMapEntry(font->metrics_map, glyph, &value) == 1)
+    {
+        return font->metrics + (uintptr_t)value;
+    }
+
+    if (!font->ttf)
+    {
+        return &g_empty_metrics;
+    }
+
+    SMF_GlyphMetrics metrics;
+    if (LoadTrueTypeMetrics(font, glyph, &metrics) == -1)
+    {
+        return &g_empty_metrics;
+    }
+
+    if (AddGlyphMetrics(font, glyph, &metrics) == -1)
+    {
+        return &g_empty_metrics;
+    }
+
+    return font->metrics + (font->metrics_len - 1);
+}
+
+static int GetKerning(SMF_Font *font, uint32_t prev, uint32_t glyph)
+{
+    uint64_t key = ((uint64_t)prev << 32) | glyph;
+
+    void *value = NULL;
+    if (font->kerning_map && SMF_FindHashMapEntry(font->kerning_map, key, &value) == 1)
+    {
+        return (int)(intptr_t)value;
+    }
+
+    SMF_LockTTF();
+    int kerning = TTF_GetFontKerningSizeGlyphs32(font->ttf, prev, glyph);
+    SMF_UnlockTTF();
+
+    if (!font->kerning_map)
+    {
+        font->kerning_map = SMF_CreateHashMap();
+        if (!font->kerning_map)
+        {
+            return kerning;
+        }
+    }
+
+    SMF_InsertHashMapEntry(font->kerning_map, key, (void *)(intptr_t)kerning);
+    return kerning;
+}
+
+// converts a distance in pixels at the reference size of a distance field font to pixels at its render size
+static int ScaleFontUnits(const SMF_Font *font, int value)
+{
+    if (font->render_size == font->reference_size)
+    {
+        return value;
+    }
+
+    return (int)SDL_floorf((float)value * font->render_size / font->reference_size + 0.5f);
+}
+
+// glyphs are stored as 8-bit coverage whenever their color comes entirely from the tint
+static SMF_Handle CreateGlyphImage(SDL_Surface *glyph_surface)
+{
+    if (glyph_surface->format->format == SDL_PIXELFORMAT_INDEX8)
+    {
+        return SMF_CreateCoverageImage(glyph_surface, SMF_MEMORY_GLYPH_SURFACES);
+    }
+
+    return SMF_CreateImageFromSurface(glyph_surface, SMF_MEMORY_GLYPH_SURFACES);
+}
+
 int AddGlyphSurfaceToFont(SMF_Font *font, uint32_t glyph, SDL_Surface *glyph_surface)
 {
-    SMF_Handle glyph_image = SMF_CreateImageFromSurface(glyph_surface);
+    SMF_Handle glyph_image = CreateGlyphImage(glyph_surface);
     if (glyph_image == SMF_INVALID_HANDLE)
     {
         SDL_FreeSurface(glyph_surface);
         return -1;
     }
 
-    if (glyph >= 32 && glyph < 128)
+    if (IS_ASCII_GLYPH(glyph))
     {
         font->ascii_map[glyph - 32] = glyph_image;
         return 0;
@@ -76,14 +361,17 @@ int AddGlyphSurfaceToFont(SMF_Font *font, uint32_t glyph, SDL_Surface *glyph_sur
     return SMF_InsertHashMapEntry(font->glyph_map, glyph, (void *)glyph_image);
 }
 
-SMF_Handle SMF_LoadTrueTypeFont(const char *path, int ttf_size)
+static SMF_Handle OpenTrueTypeFont(SDL_RWops *rw, int ttf_size)
 {
-    if (SMF_IsInitialized() == -1)
+    if (!rw)
     {
         return SMF_INVALID_HANDLE;
     }
 
-    TTF_Font *ttf = TTF_OpenFont(path, ttf_size);
+    SMF_LockTTF();
+    TTF_Font *ttf = TTF_OpenFontRW(rw, 1, ttf_size);
+    SMF_UnlockTTF();
+
     if (!ttf)
     {
         SMF_SDLError();
@@ -93,7 +381,9 @@ SMF_Handle SMF_LoadTrueTypeFont(const char *path, int ttf_size)
     SMF_Font *font = SMF_CreateHandle(&g_fonts);
     if (!font)
     {
+        SMF_LockTTF();
         TTF_CloseFont(ttf);
+        SMF_UnlockTTF();
         return SMF_INVALID_HANDLE;
     }
 
@@ -102,19 +392,87 @@ SMF_Handle SMF_LoadTrueTypeFont(const char *path, int ttf_size)
     font->is_fixed_width = TTF_FontFaceIsFixedWidth(ttf) != 0;
     font->x_adjust = 0;
 
-    SDL_Color color = {255, 255, 255};
-    for (int ix = 32; ix < 128; ++ix)
+    // glyph images are rasterized on first use (or ahead of time by SMF_PrewarmGlyphs), only the cheap ASCII metrics
+    // are loaded up front
+    for (int ix = 32; ix < 127; ++ix)
     {
-        SDL_Surface *glyph_surface = TTF_RenderGlyph32_Blended(ttf, ix, color);
-        if (glyph_surface)
-        {
-            AddGlyphSurfaceToFont(font, ix, glyph_surface);
-        }
+        LoadTrueTypeMetrics(font, ix, font->ascii_metrics + ix);
     }
 
     return font->base.handle;
 }
 
+SMF_Handle SMF_LoadTrueTypeFont(const char *path, int ttf_size)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    if (!path)
+    {
+        SMF_InvalidArgError("path");
+        return SMF_INVALID_HANDLE;
+    }
+
+    // every size of a font file reads the same mapping of the file, which is accounted for once by the file itself
+    SMF_FontFile *file = SMF_OpenFontFile(path);
+    if (!file)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    SMF_Handle font = OpenTrueTypeFont(SMF_CreateMemoryRW(file->data, file->size), ttf_size);
+    if (font == SMF_INVALID_HANDLE)
+    {
+        SMF_ReleaseFontFile(file);
+        return SMF_INVALID_HANDLE;
+    }
+
+    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
+    data->file = file;
+
+    return font;
+}
+
+SMF_Handle SMF_LoadTrueTypeFontFromMemory(const void *data, size_t size, int ttf_size)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    // the face reads the caller's buffer in place, so it owns no font data itself
+    return OpenTrueTypeFont(SMF_CreateMemoryRW(data, size), ttf_size);
+}
+
+SMF_Handle SMF_LoadTrueTypeFontFromStream(const SMF_Stream *stream, int ttf_size)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        SMF_CloseStream(stream);
+        return SMF_INVALID_HANDLE;
+    }
+
+    return OpenTrueTypeFont(SMF_CreateStreamRW(stream), ttf_size);
+}
+
+SMF_Handle SMF_LoadSDFFont(const char *path, int reference_size)
+{
+    SMF_Handle font = SMF_LoadTrueTypeFont(path, reference_size);
+    if (font == SMF_INVALID_HANDLE)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
+    data->is_sdf = 1;
+    data->reference_size = reference_size;
+    data->render_size = reference_size;
+
+    return font;
+}
+
 SMF_Handle SMF_LoadBitmapFont(const char *path, int glyph_count, const SMF_GlyphDef *glyphs, int height, int x_adjust)
 {
     if (!path)
@@ -165,7 +523,6 @@ SMF_Handle SMF_LoadBitmapFont(const char *path, int glyph_count, const SMF_Glyph
     font->height = height;
     font->x_adjust = x_adjust;
 
-    int last_width = 0;
     for (int i = 0; i < glyph_count; ++i)
     {
         const SMF_GlyphDef *def = glyphs + i;
@@ -179,7 +536,18 @@ SMF_Handle SMF_LoadBitmapFont(const char *path, int glyph_count, const SMF_Glyph
                 SDL_Rect src = {def->x, def->y, def->w, height};
                 SDL_BlitSurface(surface, &src, glyph_surface, NULL);
 
-                AddGlyphSurfaceToFont(font, def->glyph, glyph_surface);
+                SDL_Surface *coverage = SMF_ConvertToCoverage(glyph_surface);
+                if (coverage)
+                {
+                    SDL_FreeSurface(glyph_surface);
+                    glyph_surface = coverage;
+                }
+
+                if (AddGlyphSurfaceToFont(font, def->glyph, glyph_surface) == 0)
+                {
+                    SMF_GlyphMetrics metrics = {(int16_t)(def->w + x_adjust), 0, (int16_t)def->w, 0, (int16_t)height};
+                    AddGlyphMetrics(font, def->glyph, &metrics);
+                }
             }
         }
     }
@@ -188,6 +556,27 @@ SMF_Handle SMF_LoadBitmapFont(const char *path, int glyph_count, const SMF_Glyph
     return font->base.handle;
 }
 
+SMF_Font *SMF_GetFont(SMF_Handle font)
+{
+    return SMF_FindHandleObject(&g_fonts, font);
+}
+
+int SMF_GetGlyphAdvance(SMF_Font *font, uint32_t prev, uint32_t glyph)
+{
+    int advance = glyph < 128 ? font->ascii_metrics[glyph].advance : GetGlyphMetrics(font, glyph)->advance;
+    if (font->use_kerning && prev != 0)
+    {
+        advance += GetKerning(font, prev, glyph);
+    }
+
+    return advance;
+}
+
+int SMF_ScaleFontUnits(const SMF_Font *font, int value)
+{
+    return ScaleFontUnits(font, value);
+}
+
 int SMF_GetFontHeight(SMF_Handle font)
 {
     if (SMF_IsInitialized() == -1)
@@ -201,7 +590,7 @@ int SMF_GetFontHeight(SMF_Handle font)
         return -1;
     }
 
-    return data->height;
+    return ScaleFontUnits(data, data->height);
 }
 
 int SMF_IsFontFixedWidth(SMF_Handle font)
@@ -233,15 +622,15 @@ int SMF_FontContainsGlyph(SMF_Handle font, uint32_t glyph)
         return -1;
     }
 
-    if (glyph >= 32 && glyph < 128)
+    if (IS_ASCII_GLYPH(glyph) && data->ascii_map[glyph - 32] != SMF_INVALID_HANDLE)
     {
-        return data->ascii_map[glyph - 32] != SMF_INVALID_HANDLE ? 1 : 0;
+        return 1;
     }
 
     if (data->glyph_map)
     {
-        SMF_Handle image = SMF_INVALID_HANDLE;
-        if (SMF_FindHashMapEntry(data->glyph_map, glyph, (void **)&image) == 1)
+        void *value = NULL;
+        if (SMF_FindHashMapEntry(data->glyph_map, glyph, &value) == 1)
         {
             return 1;
         }
@@ -249,104 +638,778 @@ int SMF_FontContainsGlyph(SMF_Handle font, uint32_t glyph)
 
     if (data->ttf)
     {
-        return TTF_GlyphIsProvided32(data->ttf, glyph) != 0;
+        SMF_LockTTF();
+        int provided = TTF_GlyphIsProvided32(data->ttf, glyph) != 0;
+        SMF_UnlockTTF();
+
+        return provided;
     }
 
     return 0;
 }
 
-static SMF_Handle GetFontGlyphImage(SMF_Font *data, uint32_t glyph)
+static void LinkGlyphCacheEntry(SMF_GlyphCacheEntry *entry)
 {
-    if (glyph >= 32 && glyph < 128)
+    entry->prev = NULL;
+    entry->next = g_glyph_cache_head;
+    if (g_glyph_cache_head)
     {
-        return data->ascii_map[glyph - 32] != SMF_INVALID_HANDLE ? 1 : 0;
+        g_glyph_cache_head->prev = entry;
     }
-
-    if (data->glyph_map)
+    else
     {
-        SMF_Handle image = SMF_INVALID_HANDLE;
-        if (SMF_FindHashMapEntry(data->glyph_map, glyph, (void **)&image) == 1)
-        {
-            return image;
-        }
+        g_glyph_cache_tail = entry;
     }
 
-    if (data->ttf)
+    g_glyph_cache_head = entry;
+    entry->frame = SMF_GetFrameNumber();
+}
+
+static void UnlinkGlyphCacheEntry(SMF_GlyphCacheEntry *entry)
+{
+    if (entry->prev)
     {
-        SDL_Color color = {255, 255, 255};
-        SDL_Surface *glyph_surface = TTF_RenderGlyph32_Blended(data->ttf, glyph, color);
-        if (glyph_surface)
-        {
-            SMF_Handle glyph_image = SMF_CreateImageFromSurface(glyph_surface);
-            if (glyph_image != SMF_INVALID_HANDLE)
-            {
-                if (!data->glyph_map)
-                {
-                    data->glyph_map = SMF_CreateHashMap();
-                    if (!data->glyph_map)
-                    {
-                        SDL_FreeSurface(glyph_surface);
-                        return SMF_INVALID_HANDLE;
-                    }
-                }
+        entry->prev->next = entry->next;
+    }
+    else
+    {
+        g_glyph_cache_head = entry->next;
+    }
 
-                if (SMF_InsertHashMapEntry(data->glyph_map, glyph, (void *)glyph_image) == 1)
-                {
-                    return glyph_image;
-                }
-            }
-            else
-            {
-                SDL_FreeSurface(glyph_surface);
-            }
-        }
+    if (entry->next)
+    {
+        entry->next->prev = entry->prev;
+    }
+    else
+    {
+        g_glyph_cache_tail = entry->prev;
     }
+}
 
-    return SMF_INVALID_HANDLE;
+static void DestroyGlyphCacheEntry(SMF_GlyphCacheEntry *entry)
+{
+    UnlinkGlyphCacheEntry(entry);
+    SMF_DestroyImage(entry->image);
+    g_glyph_cache_size -= entry->size;
+    SMF_Free(entry);
 }
 
-SMF_Handle SMF_GetFontGlyphImage(SMF_Handle font, uint32_t glyph)
+static void EvictGlyphs(void)
 {
-    if (SMF_IsInitialized() == -1)
+    if (g_glyph_cache_budget == 0)
     {
-        return SMF_INVALID_HANDLE;
+        return;
     }
 
-    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
-    if (!data)
+    // glyphs used during the current frame may still be referenced by pending render commands, so they are kept
+    // even if that means going over the budget until the next frame
+    uint64_t frame = SMF_GetFrameNumber();
+    while (g_glyph_cache_size > g_glyph_cache_budget && g_glyph_cache_tail && g_glyph_cache_tail->frame != frame)
     {
-        return SMF_INVALID_HANDLE;
-    }
+        SMF_GlyphCacheEntry *entry = g_glyph_cache_tail;
 
-    return GetFontGlyphImage(data, glyph);
+        SMF_Font *font = SMF_FindHandleObject(&g_fonts, entry->font);
+        if (font)
+        {
+            SMF_RemoveHashMapEntry(font->glyph_map, entry->key);
+        }
+
+        DestroyGlyphCacheEntry(entry);
+        g_glyph_cache_evictions++;
+    }
 }
 
-int SMF_CalcTextWidth(SMF_Handle font, const char *text)
+static SMF_Handle AddGlyphCacheEntry(SMF_Font *data, uint64_t key, SDL_Surface *glyph_surface)
 {
-    if (SMF_IsInitialized() == -1)
+    if (!data->glyph_map)
+    {
+        data->glyph_map = SMF_CreateHashMap();
+        if (!data->glyph_map)
+        {
+            SDL_FreeSurface(glyph_surface);
+            return SMF_INVALID_HANDLE;
+        }
+    }
+
+    SMF_GlyphCacheEntry *entry = NULL;
+    if (SMF_FindHashMapEntry(data->glyph_map, key, (void **)&entry) == 1)
     {
+        SDL_FreeSurface(glyph_surface);
+        return entry->image;
+    }
+
+    entry = SMF_Calloc(1, sizeof(SMF_GlyphCacheEntry));
+    if (!entry)
+    {
+        SDL_FreeSurface(glyph_surface);
         return SMF_INVALID_HANDLE;
     }
 
-    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
-    if (!data)
+    size_t size = (size_t)glyph_surface->pitch * glyph_surface->h;
+
+    SMF_Handle glyph_image = CreateGlyphImage(glyph_surface);
+    if (glyph_image == SMF_INVALID_HANDLE)
     {
+        SDL_FreeSurface(glyph_surface);
+        SMF_Free(entry);
         return SMF_INVALID_HANDLE;
     }
 
-    int width = 0;
-    for (const char *c = text; *c; ++c)
+    if (SMF_InsertHashMapEntry(data->glyph_map, key, entry) == -1)
     {
-        SMF_Handle glyph_image = GetFontGlyphImage(data, *c);
-        if (glyph_image != SMF_INVALID_HANDLE)
-        {
-            int w = 0;
-            if (SMF_GetImageSize(glyph_image, &w, NULL) == 0)
-            {
-                width += (w + data->x_adjust);
-            }
-        }
+        SMF_DestroyImage(glyph_image);
+        SMF_Free(entry);
+        return SMF_INVALID_HANDLE;
     }
 
-    return width;
+    entry->font = data->base.handle;
+    entry->key = key;
+    entry->image = glyph_image;
+    entry->size = size;
+
+    LinkGlyphCacheEntry(entry);
+    g_glyph_cache_size += size;
+
+    EvictGlyphs();
+
+    return glyph_image;
+}
+
+static SMF_Handle CacheGlyphSurface(SMF_Font *data, uint32_t glyph, SDL_Surface *glyph_surface)
+{
+    if (IS_ASCII_GLYPH(glyph))
+    {
+        data->ascii_rasterized[glyph - 32] = 1;
+        if (data->ascii_map[glyph - 32] != SMF_INVALID_HANDLE)
+        {
+            SDL_FreeSurface(glyph_surface);
+            return data->ascii_map[glyph - 32];
+        }
+
+        if (AddGlyphSurfaceToFont(data, glyph, glyph_surface) == -1)
+        {
+            return SMF_INVALID_HANDLE;
+        }
+
+        return data->ascii_map[glyph - 32];
+    }
+
+    return AddGlyphCacheEntry(data, glyph, glyph_surface);
+}
+
+static SDL_Surface *RenderGlyphSurface(SMF_Font *data, uint32_t glyph)
+{
+    SDL_Color fg = {255, 255, 255, 255};
+    SDL_Color bg = {0, 0, 0, 0};
+
+    // shaded rendering produces the 8-bit coverage directly (the palette index is the coverage)
+    SMF_LockTTF();
+    SDL_Surface *glyph_surface = TTF_RenderGlyph32_Shaded(data->ttf, glyph, fg, bg);
+    SMF_UnlockTTF();
+
+    if (!glyph_surface)
+    {
+        SMF_SDLError();
+    }
+
+    return glyph_surface;
+}
+
+static SMF_Handle RasterizeGlyph(SMF_Font *data, uint32_t glyph)
+{
+    SDL_Surface *glyph_surface = RenderGlyphSurface(data, glyph);
+    if (!glyph_surface)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    return CacheGlyphSurface(data, glyph, glyph_surface);
+}
+
+static int GrowArray(void **array, size_t *cap, size_t needed, size_t elem_size)
+{
+    if (needed <= *cap)
+    {
+        return 0;
+    }
+
+    size_t new_cap = *cap == 0 ? INITIAL_METRICS_CAPACITY : *cap;
+    while (new_cap < needed)
+    {
+        new_cap *= 2;
+    }
+
+    void *new_array = SMF_Calloc(new_cap, elem_size);
+    if (!new_array)
+    {
+        return -1;
+    }
+
+    if (*array)
+    {
+        memcpy(new_array, *array, *cap * elem_size);
+        SMF_Free(*array);
+        SMF_TrackFree(SMF_MEMORY_DISTANCE_FIELDS, *cap * elem_size);
+    }
+
+    SMF_TrackAlloc(SMF_MEMORY_DISTANCE_FIELDS, new_cap * elem_size);
+
+    *array = new_array;
+    *cap = new_cap;
+
+    return 0;
+}
+
+static const SMF_DistanceField *AddDistanceField(SMF_Font *data, uint32_t glyph, SDL_Surface *glyph_surface)
+{
+    void *value = NULL;
+    if (data->field_map && SMF_FindHashMapEntry(data->field_map, glyph, &value) == 1)
+    {
+        SDL_FreeSurface(glyph_surface);
+        return data->fields + (uintptr_t)value;
+    }
+
+    if (!data->field_map)
+    {
+        data->field_map = SMF_CreateHashMap();
+        if (!data->field_map)
+        {
+            SDL_FreeSurface(glyph_surface);
+            return NULL;
+        }
+    }
+
+    if (GrowArray((void **)&data->fields, &data->fields_cap, data->fields_len + 1, sizeof(SMF_DistanceField)) == -1)
+    {
+        SDL_FreeSurface(glyph_surface);
+        return NULL;
+    }
+
+    // glyphs that fail to rasterize keep an empty field so they are not rasterized again on every use
+    SMF_DistanceField field = {0, 0, 0};
+    if (glyph_surface)
+    {
+        int w = glyph_surface->w + SMF_SDF_SPREAD * 2;
+        int h = glyph_surface->h + SMF_SDF_SPREAD * 2;
+        size_t size = (size_t)w * h;
+
+        if (w <= UINT16_MAX && h <= UINT16_MAX && data->atlas_len + size <= UINT32_MAX &&
+            GrowArray((void **)&data->atlas, &data->atlas_cap, data->atlas_len + size, 1) == 0 &&
+            SMF_BuildDistanceField(glyph_surface, data->atlas + data->atlas_len) == 0)
+        {
+            field.offset = (uint32_t)data->atlas_len;
+            field.w = (uint16_t)w;
+            field.h = (uint16_t)h;
+            data->atlas_len += size;
+        }
+
+        SDL_FreeSurface(glyph_surface);
+    }
+
+    if (SMF_InsertHashMapEntry(data->field_map, glyph, (void *)(uintptr_t)data->fields_len) == -1)
+    {
+        return NULL;
+    }
+
+    data->fields[data->fields_len] = field;
+    data->fields_len++;
+
+    return data->fields + (data->fields_len - 1);
+}
+
+static SMF_Handle GetDistanceFieldImage(SMF_Font *data, uint32_t glyph)
+{
+    // each render size has its own images in the glyph cache, the field they are expanded from is shared
+    uint64_t key = ((uint64_t)data->render_size << 32) | glyph;
+
+    SMF_GlyphCacheEntry *entry = NULL;
+    if (data->glyph_map && SMF_FindHashMapEntry(data->glyph_map, key, (void **)&entry) == 1)
+    {
+        g_glyph_cache_hits++;
+
+        UnlinkGlyphCacheEntry(entry);
+        LinkGlyphCacheEntry(entry);
+
+        return entry->image;
+    }
+
+    g_glyph_cache_misses++;
+
+    if (SMF_HasRasterizedGlyphs())
+    {
+        SMF_PublishPrewarmedGlyphs();
+    }
+
+    const SMF_DistanceField *field = NULL;
+
+    void *value = NULL;
+    if (data->field_map && SMF_FindHashMapEntry(data->field_map, glyph, &value) == 1)
+    {
+        field = data->fields + (uintptr_t)value;
+    }
+    else
+    {
+        field = AddDistanceField(data, glyph, RenderGlyphSurface(data, glyph));
+    }
+
+    if (!field || field->w == 0)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    const uint8_t *pixels = data->atlas + field->offset;
+    SDL_Surface *glyph_surface =
+        SMF_ExpandDistanceField(pixels, field->w, field->h, data->render_size, data->reference_size);
+    if (!glyph_surface)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    return AddGlyphCacheEntry(data, key, glyph_surface);
+}
+
+void SMF_PublishPrewarmedGlyphs(void)
+{
+    SMF_RasterizedGlyph *result = SMF_TakeRasterizedGlyphs();
+    while (result)
+    {
+        SMF_RasterizedGlyph *next = result->next;
+
+        SMF_Font *data = SMF_FindHandleObject(&g_fonts, result->font);
+        if (data && data->is_sdf)
+        {
+            AddDistanceField(data, result->glyph, result->surface);
+        }
+        else if (data)
+        {
+            CacheGlyphSurface(data, result->glyph, result->surface);
+        }
+        else
+        {
+            SDL_FreeSurface(result->surface);
+        }
+
+        SMF_Free(result);
+        result = next;
+    }
+}
+
+static SMF_Handle GetFontGlyphImage(SMF_Font *data, uint32_t glyph)
+{
+    if (data->is_sdf)
+    {
+        return GetDistanceFieldImage(data, glyph);
+    }
+
+    if (IS_ASCII_GLYPH(glyph))
+    {
+        SMF_Handle image = data->ascii_map[glyph - 32];
+        if (image != SMF_INVALID_HANDLE || !data->ttf || data->ascii_rasterized[glyph - 32])
+        {
+            return image;
+        }
+
+        if (SMF_HasRasterizedGlyphs())
+        {
+            SMF_PublishPrewarmedGlyphs();
+            if (data->ascii_map[glyph - 32] != SMF_INVALID_HANDLE)
+            {
+                return data->ascii_map[glyph - 32];
+            }
+        }
+
+        data->ascii_rasterized[glyph - 32] = 1;
+        return RasterizeGlyph(data, glyph);
+    }
+
+    // bitmap fonts map directly to their (pinned) glyph images
+    if (!data->ttf)
+    {
+        SMF_Handle image = SMF_INVALID_HANDLE;
+        if (data->glyph_map && SMF_FindHashMapEntry(data->glyph_map, glyph, (void **)&image) == 1)
+        {
+            return image;
+        }
+
+        return SMF_INVALID_HANDLE;
+    }
+
+    SMF_GlyphCacheEntry *entry = NULL;
+    if (data->glyph_map && SMF_FindHashMapEntry(data->glyph_map, glyph, (void **)&entry) == 1)
+    {
+        g_glyph_cache_hits++;
+
+        UnlinkGlyphCacheEntry(entry);
+        LinkGlyphCacheEntry(entry);
+
+        return entry->image;
+    }
+
+    // the glyph may be waiting in the prewarm results, in which case there is no need to rasterize it here
+    if (SMF_HasRasterizedGlyphs())
+    {
+        SMF_PublishPrewarmedGlyphs();
+        if (data->glyph_map && SMF_FindHashMapEntry(data->glyph_map, glyph, (void **)&entry) == 1)
+        {
+            g_glyph_cache_hits++;
+            return entry->image;
+        }
+    }
+
+    g_glyph_cache_misses++;
+    return RasterizeGlyph(data, glyph);
+}
+
+SMF_Handle SMF_GetFontGlyphImage(SMF_Handle font, uint32_t glyph)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
+    if (!data)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    return GetFontGlyphImage(data, glyph);
+}
+
+static int CalcTextWidth(SMF_Font *data, const char *text, size_t len)
+{
+    int width = 0;
+    int use_kerning = data->use_kerning;
+    uint32_t prev = 0;
+
+    size_t pos = 0;
+    while (pos < len)
+    {
+        // runs of ASCII are measured straight from the metrics table without decoding
+        size_t end = pos + SMF_CountASCII(text + pos, len - pos);
+        for (; pos < end; ++pos)
+        {
+            uint32_t c = (uint8_t)text[pos];
+            width += data->ascii_metrics[c].advance;
+            if (use_kerning && prev != 0)
+            {
+                width += GetKerning(data, prev, c);
+            }
+            prev = c;
+        }
+
+        if (pos < len)
+        {
+            uint32_t glyph = SMF_DecodeUTF8(text, len, &pos);
+            width += GetGlyphMetrics(data, glyph)->advance;
+            if (use_kerning && prev != 0)
+            {
+                width += GetKerning(data, prev, glyph);
+            }
+            prev = glyph;
+        }
+    }
+
+    return ScaleFontUnits(data, width);
+}
+
+int SMF_CalcTextWidth(SMF_Handle font, const char *text)
+{
+    if (!text)
+    {
+        return SMF_InvalidArgError("text");
+    }
+
+    return SMF_CalcTextWidthN(font, text, strlen(text));
+}
+
+int SMF_CalcTextWidthN(SMF_Handle font, const char *text, size_t len)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!text && len > 0)
+    {
+        return SMF_InvalidArgError("text");
+    }
+
+    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
+    if (!data)
+    {
+        return -1;
+    }
+
+    return CalcTextWidth(data, text, len);
+}
+
+int SMF_RenderGlyph(SMF_Handle font, uint32_t glyph, int x, int y)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
+    if (!data)
+    {
+        return -1;
+    }
+
+    SMF_Handle glyph_image = GetFontGlyphImage(data, glyph);
+    if (glyph_image == SMF_INVALID_HANDLE)
+    {
+        return 0;
+    }
+
+    return SMF_PushImageCommand(glyph_image, x, y);
+}
+
+static int RenderText(SMF_Font *data, const char *text, size_t len, int x, int y)
+{
+    int use_kerning = data->use_kerning;
+    uint32_t prev = 0;
+
+    // the pen advances in font units, which only differ from pixels for a distance field font
+    int pen = 0;
+
+    size_t pos = 0;
+    while (pos < len)
+    {
+        size_t end = pos + SMF_CountASCII(text + pos, len - pos);
+        for (; pos < end; ++pos)
+        {
+            uint32_t c = (uint8_t)text[pos];
+            if (use_kerning && prev != 0)
+            {
+                pen += GetKerning(data, prev, c);
+            }
+            prev = c;
+
+            // control characters only have an image if a bitmap font defines one for them
+            SMF_Handle glyph_image = SMF_INVALID_HANDLE;
+            if (IS_ASCII_GLYPH(c))
+            {
+                glyph_image = data->ascii_map[c - 32];
+                if (glyph_image == SMF_INVALID_HANDLE && data->ttf)
+                {
+                    glyph_image = GetFontGlyphImage(data, c);
+                }
+            }
+            else if (data->ascii_metrics[c].advance != 0)
+            {
+                glyph_image = GetFontGlyphImage(data, c);
+            }
+
+            if (glyph_image != SMF_INVALID_HANDLE)
+            {
+                if (SMF_PushImageCommand(glyph_image, x + ScaleFontUnits(data, pen), y) == -1)
+                {
+                    return -1;
+                }
+            }
+
+            pen += data->ascii_metrics[c].advance;
+        }
+
+        if (pos < len)
+        {
+            uint32_t glyph = SMF_DecodeUTF8(text, len, &pos);
+            if (use_kerning && prev != 0)
+            {
+                pen += GetKerning(data, prev, glyph);
+            }
+            prev = glyph;
+
+            SMF_Handle glyph_image = GetFontGlyphImage(data, glyph);
+            if (glyph_image != SMF_INVALID_HANDLE)
+            {
+                if (SMF_PushImageCommand(glyph_image, x + ScaleFontUnits(data, pen), y) == -1)
+                {
+                    return -1;
+                }
+            }
+
+            pen += GetGlyphMetrics(data, glyph)->advance;
+        }
+    }
+
+    return 0;
+}
+
+int SMF_RenderText(SMF_Handle font, const char *text, int x, int y)
+{
+    if (!text)
+    {
+        return SMF_InvalidArgError("text");
+    }
+
+    return SMF_RenderTextN(font, text, strlen(text), x, y);
+}
+
+int SMF_RenderTextN(SMF_Handle font, const char *text, size_t len, int x, int y)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    if (!text && len > 0)
+    {
+        return SMF_InvalidArgError("text");
+    }
+
+    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
+    if (!data)
+    {
+        return -1;
+    }
+
+    return RenderText(data, text, len, x, y);
+}
+
+void SMF_SetGlyphCacheBudget(size_t bytes)
+{
+    g_glyph_cache_budget = bytes;
+    EvictGlyphs();
+}
+
+int SMF_GetGlyphCacheStats(SMF_GlyphCacheStats *stats)
+{
+    if (!stats)
+    {
+        return SMF_InvalidArgError("stats");
+    }
+
+    stats->hits = g_glyph_cache_hits;
+    stats->misses = g_glyph_cache_misses;
+    stats->evictions = g_glyph_cache_evictions;
+    stats->size = g_glyph_cache_size;
+    stats->budget = g_glyph_cache_budget;
+
+    return 0;
+}
+
+int SMF_GetFontGlyphMetrics(SMF_Handle font, uint32_t glyph, SMF_GlyphInfo *info)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!info)
+    {
+        return SMF_InvalidArgError("info");
+    }
+
+    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
+    if (!data)
+    {
+        return -1;
+    }
+
+    const SMF_GlyphMetrics *metrics = GetGlyphMetrics(data, glyph);
+    info->advance = ScaleFontUnits(data, metrics->advance);
+    info->min_x = ScaleFontUnits(data, metrics->min_x);
+    info->max_x = ScaleFontUnits(data, metrics->max_x);
+    info->min_y = ScaleFontUnits(data, metrics->min_y);
+    info->max_y = ScaleFontUnits(data, metrics->max_y);
+
+    return 0;
+}
+
+int SMF_SetFontKerning(SMF_Handle font, int enabled)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
+    if (!data)
+    {
+        return -1;
+    }
+
+    // bitmap fonts have no kerning information
+    data->use_kerning = data->ttf && enabled;
+    return 0;
+}
+
+int SMF_PrewarmGlyphs(SMF_Handle font, const SMF_GlyphRange *ranges, int count)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (count <= 0)
+    {
+        return SMF_InvalidArgError("count");
+    }
+
+    if (!ranges)
+    {
+        return SMF_InvalidArgError("ranges");
+    }
+
+    for (int ix = 0; ix < count; ++ix)
+    {
+        if (ranges[ix].first > ranges[ix].last)
+        {
+            return SMF_InvalidArgError("ranges");
+        }
+    }
+
+    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
+    if (!data)
+    {
+        return -1;
+    }
+
+    // bitmap fonts have nothing left to rasterize
+    if (!data->ttf)
+    {
+        return 0;
+    }
+
+    return SMF_QueueGlyphRanges(font, data->ttf, ranges, count);
+}
+
+int SMF_SetFontSize(SMF_Handle font, int size)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (size <= 0)
+    {
+        return SMF_InvalidArgError("size");
+    }
+
+    SMF_Font *data = SMF_FindHandleObject(&g_fonts, font);
+    if (!data)
+    {
+        return -1;
+    }
+
+    if (!data->is_sdf)
+    {
+        return SMF_SetError("font is not a distance field font");
+    }
+
+    data->render_size = size;
+    return 0;
 }
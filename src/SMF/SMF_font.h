@@ -5,3 +5,10 @@
 
 int SMF_InitFonts(void);
 void SMF_CleanFonts(void);
+void SMF_PublishPrewarmedGlyphs(void);
+
+typedef struct SMF_Font SMF_Font;
+
+SMF_Font *SMF_GetFont(SMF_Handle font);
+int SMF_GetGlyphAdvance(SMF_Font *font, uint32_t prev, uint32_t glyph);
+int SMF_ScaleFontUnits(const SMF_Font *font, int value);
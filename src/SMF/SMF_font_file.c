@@ -0,0 +1,277 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_font_file.h"
+
+#include "SMF_context.h"
+#include "SMF_mem.h"
+
+// open font files, there are only ever a handful so a list is enough
+static SMF_FontFile *g_font_files = NULL;
+
+#if defined(_WIN32)
+
+static void *MapFile(const char *path, size_t *size)
+{
+    wchar_t wide_path[MAX_PATH];
+    if (MultiByteToWideChar(CP_UTF8, 0, path, -1, wide_path, MAX_PATH) == 0)
+    {
+        return NULL;
+    }
+
+    HANDLE file = CreateFileW(wide_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0 || (uint64_t)file_size.QuadPart > SIZE_MAX)
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        return NULL;
+    }
+
+    // the view keeps the mapping alive on its own
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+    {
+        return NULL;
+    }
+
+    *size = (size_t)file_size.QuadPart;
+    return data;
+}
+
+static void UnmapFile(void *data, size_t size)
+{
+    UnmapViewOfFile(data);
+}
+
+static size_t GetResidentSize(const void *data, size_t size)
+{
+    // the working set of a view is not cheap to query, so the whole view is reported
+    return size;
+}
+
+#else
+
+static void *MapFile(const char *path, size_t *size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size <= 0 || (uint64_t)st.st_size > SIZE_MAX)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    *size = (size_t)st.st_size;
+    return data;
+}
+
+static void UnmapFile(void *data, size_t size)
+{
+    munmap(data, size);
+}
+
+static size_t GetResidentSize(const void *data, size_t size)
+{
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages = (size + page_size - 1) / page_size;
+
+#if defined(__APPLE__)
+    char *residency = SMF_Calloc(pages, 1);
+#else
+    unsigned char *residency = SMF_Calloc(pages, 1);
+#endif
+    if (!residency)
+    {
+        return 0;
+    }
+
+    size_t resident = 0;
+    if (mincore((void *)data, size, residency) == 0)
+    {
+        for (size_t ix = 0; ix < pages; ++ix)
+        {
+            if (residency[ix] & 1)
+            {
+                resident += page_size;
+            }
+        }
+    }
+
+    SMF_Free(residency);
+
+    return resident < size ? resident : size;
+}
+
+#endif
+
+// fallback for files that cannot be mapped (the data is read into memory instead)
+static void *ReadWholeFile(const char *path, size_t *size)
+{
+    SDL_RWops *rw = SDL_RWFromFile(path, "rb");
+    if (!rw)
+    {
+        SMF_SDLError();
+        return NULL;
+    }
+
+    Sint64 file_size = SDL_RWsize(rw);
+    if (file_size <= 0 || (uint64_t)file_size > SIZE_MAX)
+    {
+        SDL_RWclose(rw);
+        SMF_SetError("unable to determine the size of %s", path);
+        return NULL;
+    }
+
+    void *data = SMF_Calloc((size_t)file_size, 1);
+    if (!data)
+    {
+        SDL_RWclose(rw);
+        return NULL;
+    }
+
+    if (SDL_RWread(rw, data, (size_t)file_size, 1) != 1)
+    {
+        SMF_SDLError();
+        SDL_RWclose(rw);
+        SMF_Free(data);
+        return NULL;
+    }
+
+    SDL_RWclose(rw);
+
+    *size = (size_t)file_size;
+    return data;
+}
+
+SMF_FontFile *SMF_OpenFontFile(const char *path)
+{
+    for (SMF_FontFile *file = g_font_files; file; file = file->next)
+    {
+        if (strcmp(file->path, path) == 0)
+        {
+            file->refs++;
+            return file;
+        }
+    }
+
+    size_t path_len = strlen(path);
+
+    SMF_FontFile *file = SMF_Calloc(1, sizeof(SMF_FontFile) + path_len + 1);
+    if (!file)
+    {
+        return NULL;
+    }
+
+    file->path = (char *)(file + 1);
+    memcpy(file->path, path, path_len + 1);
+
+    file->data = MapFile(path, &file->size);
+    file->is_mapped = file->data != NULL;
+    if (!file->data)
+    {
+        file->data = ReadWholeFile(path, &file->size);
+        if (!file->data)
+        {
+            SMF_Free(file);
+            return NULL;
+        }
+    }
+
+    file->refs = 1;
+    file->next = g_font_files;
+    g_font_files = file;
+
+    SMF_TrackAlloc(SMF_MEMORY_FONT_FACES, file->size);
+
+    return file;
+}
+
+void SMF_ReleaseFontFile(SMF_FontFile *file)
+{
+    if (--file->refs > 0)
+    {
+        return;
+    }
+
+    SMF_FontFile **link = &g_font_files;
+    while (*link != file)
+    {
+        link = &(*link)->next;
+    }
+    *link = file->next;
+
+    SMF_TrackFree(SMF_MEMORY_FONT_FACES, file->size);
+
+    if (file->is_mapped)
+    {
+        UnmapFile(file->data, file->size);
+    }
+    else
+    {
+        SMF_Free(file->data);
+    }
+
+    SMF_Free(file);
+}
+
+int SMF_GetFontFileStats(SMF_FontFileStats *stats)
+{
+    if (!stats)
+    {
+        return SMF_InvalidArgError("stats");
+    }
+
+    memset(stats, 0, sizeof(SMF_FontFileStats));
+
+    for (SMF_FontFile *file = g_font_files; file; file = file->next)
+    {
+        stats->files++;
+        stats->faces += file->refs;
+        stats->shared_faces += file->refs - 1;
+        stats->mapped_bytes += file->is_mapped ? file->size : 0;
+        stats->resident_bytes += file->is_mapped ? GetResidentSize(file->data, file->size) : file->size;
+    }
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// font file shared by every face opened from the same path
+typedef struct SMF_FontFile
+{
+    struct SMF_FontFile *next;
+    char *path;
+    void *data;
+    size_t size;
+    int is_mapped;
+    int refs;
+} SMF_FontFile;
+
+SMF_FontFile *SMF_OpenFontFile(const char *path);
+void SMF_ReleaseFontFile(SMF_FontFile *file);
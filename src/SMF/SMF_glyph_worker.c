@@ -0,0 +1,323 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_glyph_worker.h"
+
+#include "SMF_context.h"
+#include "SMF_mem.h"
+
+typedef struct SMF_GlyphJob
+{
+    struct SMF_GlyphJob *next;
+    SMF_Handle font;
+    TTF_Font *ttf;
+    SDL_atomic_t is_cancelled;
+    int count;
+    SMF_GlyphRange ranges[];
+} SMF_GlyphJob;
+
+static SDL_Thread *g_thread = NULL;
+static SDL_mutex *g_lock = NULL;
+static SDL_cond *g_cond = NULL;
+static SDL_atomic_t g_quit;
+
+// the job the worker is running (guarded by g_lock), with a condition signaled whenever it finishes one
+static SMF_GlyphJob *g_current_job = NULL;
+static SDL_cond *g_job_done_cond = NULL;
+
+// FreeType is not safe to use from several threads at once, so every TTF call is serialized while the worker runs
+static SDL_mutex *g_ttf_lock = NULL;
+
+static SMF_GlyphJob *g_jobs_head = NULL;
+static SMF_GlyphJob *g_jobs_tail = NULL;
+
+static SMF_RasterizedGlyph *g_done_head = NULL;
+static SMF_RasterizedGlyph *g_done_tail = NULL;
+
+static void PublishGlyph(SMF_Handle font, uint32_t glyph, SDL_Surface *surface)
+{
+    // this runs on the worker, which must not touch the error state of the main thread
+    SMF_RasterizedGlyph *result = SMF_TryCalloc(1, sizeof(SMF_RasterizedGlyph));
+    if (!result)
+    {
+        SDL_FreeSurface(surface);
+        return;
+    }
+
+    result->font = font;
+    result->glyph = glyph;
+    result->surface = surface;
+
+    SDL_LockMutex(g_lock);
+    if (g_done_tail)
+    {
+        g_done_tail->next = result;
+    }
+    else
+    {
+        SDL_AtomicSetPtr((void **)&g_done_head, result);
+    }
+    g_done_tail = result;
+    SDL_UnlockMutex(g_lock);
+}
+
+static void RunJob(SMF_GlyphJob *job)
+{
+    SDL_Color fg = {255, 255, 255, 255};
+    SDL_Color bg = {0, 0, 0, 0};
+
+    for (int ix = 0; ix < job->count; ++ix)
+    {
+        for (uint64_t glyph = job->ranges[ix].first; glyph <= job->ranges[ix].last; ++glyph)
+        {
+            if (SDL_AtomicGet(&g_quit) || SDL_AtomicGet(&job->is_cancelled))
+            {
+                return;
+            }
+
+            SDL_Surface *surface = NULL;
+
+            SDL_LockMutex(g_ttf_lock);
+            if (TTF_GlyphIsProvided32(job->ttf, (uint32_t)glyph))
+            {
+                surface = TTF_RenderGlyph32_Shaded(job->ttf, (uint32_t)glyph, fg, bg);
+            }
+            SDL_UnlockMutex(g_ttf_lock);
+
+            if (surface)
+            {
+                PublishGlyph(job->font, (uint32_t)glyph, surface);
+            }
+        }
+    }
+}
+
+static int SDLCALL WorkerMain(void *data)
+{
+    SDL_LockMutex(g_lock);
+    while (!SDL_AtomicGet(&g_quit))
+    {
+        if (!g_jobs_head)
+        {
+            SDL_CondWait(g_cond, g_lock);
+            continue;
+        }
+
+        SMF_GlyphJob *job = g_jobs_head;
+        g_jobs_head = job->next;
+        if (!g_jobs_head)
+        {
+            g_jobs_tail = NULL;
+        }
+
+        g_current_job = job;
+
+        SDL_UnlockMutex(g_lock);
+        RunJob(job);
+        SDL_LockMutex(g_lock);
+
+        g_current_job = NULL;
+        SDL_CondBroadcast(g_job_done_cond);
+        SMF_Free(job);
+    }
+    SDL_UnlockMutex(g_lock);
+
+    return 0;
+}
+
+static int StartWorker(void)
+{
+    g_lock = SDL_CreateMutex();
+    g_cond = SDL_CreateCond();
+    g_job_done_cond = SDL_CreateCond();
+    g_ttf_lock = SDL_CreateMutex();
+    if (!g_lock || !g_cond || !g_job_done_cond || !g_ttf_lock)
+    {
+        SMF_SDLError();
+        SMF_CleanGlyphWorker();
+        return -1;
+    }
+
+    SDL_AtomicSet(&g_quit, 0);
+
+    g_thread = SDL_CreateThread(WorkerMain, "SMF_GlyphWorker", NULL);
+    if (!g_thread)
+    {
+        SMF_SDLError();
+        SMF_CleanGlyphWorker();
+        return -1;
+    }
+
+    return 0;
+}
+
+void SMF_CleanGlyphWorker(void)
+{
+    if (g_thread)
+    {
+        SDL_LockMutex(g_lock);
+        SDL_AtomicSet(&g_quit, 1);
+        SDL_CondSignal(g_cond);
+        SDL_UnlockMutex(g_lock);
+
+        SDL_WaitThread(g_thread, NULL);
+        g_thread = NULL;
+    }
+
+    while (g_jobs_head)
+    {
+        SMF_GlyphJob *next = g_jobs_head->next;
+        SMF_Free(g_jobs_head);
+        g_jobs_head = next;
+    }
+    g_jobs_tail = NULL;
+
+    while (g_done_head)
+    {
+        SMF_RasterizedGlyph *next = g_done_head->next;
+        SDL_FreeSurface(g_done_head->surface);
+        SMF_Free(g_done_head);
+        g_done_head = next;
+    }
+    g_done_tail = NULL;
+
+    SDL_DestroyCond(g_cond);
+    SDL_DestroyCond(g_job_done_cond);
+    SDL_DestroyMutex(g_lock);
+    SDL_DestroyMutex(g_ttf_lock);
+    g_cond = NULL;
+    g_job_done_cond = NULL;
+    g_lock = NULL;
+    g_ttf_lock = NULL;
+}
+
+int SMF_QueueGlyphRanges(SMF_Handle font, TTF_Font *ttf, const SMF_GlyphRange *ranges, int count)
+{
+    if (!g_thread && StartWorker() == -1)
+    {
+        return -1;
+    }
+
+    SMF_GlyphJob *job = SMF_Calloc(1, sizeof(SMF_GlyphJob) + sizeof(SMF_GlyphRange) * count);
+    if (!job)
+    {
+        return -1;
+    }
+
+    job->font = font;
+    job->ttf = ttf;
+    job->count = count;
+    memcpy(job->ranges, ranges, sizeof(SMF_GlyphRange) * count);
+
+    SDL_LockMutex(g_lock);
+    if (g_jobs_tail)
+    {
+        g_jobs_tail->next = job;
+    }
+    else
+    {
+        g_jobs_head = job;
+    }
+    g_jobs_tail = job;
+    SDL_CondSignal(g_cond);
+    SDL_UnlockMutex(g_lock);
+
+    return 0;
+}
+
+void SMF_CancelGlyphJobs(SMF_Handle font)
+{
+    if (!g_thread)
+    {
+        return;
+    }
+
+    SDL_LockMutex(g_lock);
+
+    SMF_GlyphJob *prev = NULL;
+    SMF_GlyphJob *job = g_jobs_head;
+    while (job)
+    {
+        SMF_GlyphJob *next = job->next;
+        if (job->font == font)
+        {
+            if (prev)
+            {
+                prev->next = next;
+            }
+            else
+            {
+                g_jobs_head = next;
+            }
+
+            if (g_jobs_tail == job)
+            {
+                g_jobs_tail = prev;
+            }
+
+            SMF_Free(job);
+        }
+        else
+        {
+            prev = job;
+        }
+
+        job = next;
+    }
+
+    // the running job stops at its next glyph, glyphs it already published are dropped when their font is not found
+    if (g_current_job && g_current_job->font == font)
+    {
+        SDL_AtomicSet(&g_current_job->is_cancelled, 1);
+        while (g_current_job && g_current_job->font == font)
+        {
+            SDL_CondWait(g_job_done_cond, g_lock);
+        }
+    }
+
+    SDL_UnlockMutex(g_lock);
+}
+
+int SMF_HasRasterizedGlyphs(void)
+{
+    return SDL_AtomicGetPtr((void **)&g_done_head) != NULL;
+}
+
+SMF_RasterizedGlyph *SMF_TakeRasterizedGlyphs(void)
+{
+    if (!g_lock)
+    {
+        return NULL;
+    }
+
+    SDL_LockMutex(g_lock);
+    SMF_RasterizedGlyph *results = g_done_head;
+    SDL_AtomicSetPtr((void **)&g_done_head, NULL);
+    g_done_tail = NULL;
+    SDL_UnlockMutex(g_lock);
+
+    return results;
+}
+
+void SMF_LockTTF(void)
+{
+    if (g_ttf_lock)
+    {
+        SDL_LockMutex(g_ttf_lock);
+    }
+}
+
+void SMF_UnlockTTF(void)
+{
+    if (g_ttf_lock)
+    {
+        SDL_UnlockMutex(g_ttf_lock);
+    }
+}
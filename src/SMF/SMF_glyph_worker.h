@@ -0,0 +1,22 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+typedef struct SMF_RasterizedGlyph
+{
+    struct SMF_RasterizedGlyph *next;
+    SMF_Handle font;
+    uint32_t glyph;
+    SDL_Surface *surface;
+} SMF_RasterizedGlyph;
+
+void SMF_CleanGlyphWorker(void);
+
+int SMF_QueueGlyphRanges(SMF_Handle font, TTF_Font *ttf, const SMF_GlyphRange *ranges, int count);
+void SMF_CancelGlyphJobs(SMF_Handle font);
+int SMF_HasRasterizedGlyphs(void);
+SMF_RasterizedGlyph *SMF_TakeRasterizedGlyphs(void);
+
+void SMF_LockTTF(void);
+void SMF_UnlockTTF(void);
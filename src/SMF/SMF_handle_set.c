@@ -4,6 +4,8 @@
 #include <assert.h>
 #include <string.h>
 
+#include "SMF/SMF.h"
+
 #include "SMF_handle_set.h"
 
 #include "SMF_context.h"
@@ -13,7 +15,7 @@ int SMF_InitHandleSet(SMF_HandleSet *handle_set, SMF_HandleType type, size_t dat
 {
     assert(handle_set);
     assert(type >= SMF_HANDLE_TYPE_IMAGE);
-    assert(type <= SMF_HANDLE_TYPE_FONT);
+    assert(type <= SMF_HANDLE_TYPE_NINE_SLICE);
     assert(data_size >= sizeof(SMF_HandleObject));
     assert(clean_cb);
 
@@ -23,12 +25,15 @@ int SMF_InitHandleSet(SMF_HandleSet *handle_set, SMF_HandleType type, size_t dat
     handle_set->next_id = 1;
     handle_set->data_cap = 16;
     handle_set->data_len = 0;
+    handle_set->free_head = 0;
     handle_set->data = SMF_Calloc(handle_set->data_cap, handle_set->data_size);
     if (!handle_set->data)
     {
         return -1;
     }
 
+    SMF_TrackAlloc(SMF_MEMORY_HANDLE_SETS, handle_set->data_cap * handle_set->data_size);
+
     return 0;
 }
 
@@ -36,15 +41,19 @@ void SMF_CleanHandleSet(SMF_HandleSet *handle_set)
 {
     assert(handle_set);
 
+    uint64_t used = 0;
     for (uint64_t ix = 0; ix < handle_set->data_len; ++ix)
     {
         SMF_HandleObject *obj = (SMF_HandleObject *)(handle_set->data + (ix * handle_set->data_size));
         if (obj->handle != 0)
         {
             handle_set->clean_cb(obj);
+            used += handle_set->data_size;
         }
     }
 
+    SMF_TrackFree(SMF_MEMORY_HANDLE_SETS, handle_set->data_cap * handle_set->data_size);
+    SMF_TrackHandleSetUsage(-(int64_t)used);
     SMF_Free(handle_set->data);
 }
 
@@ -58,6 +67,23 @@ void *SMF_CreateHandle(SMF_HandleSet *handle_set)
         return NULL;
     }
 
+    // reuse destroyed slots first (the free list stores the slot index plus one so that 0 marks the end)
+    if (handle_set->free_head != 0)
+    {
+        uint64_t ix = handle_set->free_head - 1;
+        SMF_HandleObject *obj = (SMF_HandleObject *)(handle_set->data + (ix * handle_set->data_size));
+        handle_set->free_head = obj->next_free;
+
+        memset(obj, 0, handle_set->data_size);
+
+        uint64_t id = handle_set->next_id++;
+        obj->handle = SMF_MAKE_HANDLE(handle_set->type, ix, id);
+
+        SMF_TrackHandleSetUsage((int64_t)handle_set->data_size);
+
+        return obj;
+    }
+
     if (handle_set->data_len == handle_set->data_cap)
     {
         if (handle_set->data_cap >= 0x1000000)
@@ -81,6 +107,9 @@ void *SMF_CreateHandle(SMF_HandleSet *handle_set)
         memcpy(new_data, handle_set->data, handle_set->data_len * handle_set->data_size);
         SMF_Free(handle_set->data);
 
+        SMF_TrackAlloc(SMF_MEMORY_HANDLE_SETS, new_cap * handle_set->data_size);
+        SMF_TrackFree(SMF_MEMORY_HANDLE_SETS, handle_set->data_cap * handle_set->data_size);
+
         handle_set->data = new_data;
         handle_set->data_cap = new_cap;
     }
@@ -89,7 +118,9 @@ void *SMF_CreateHandle(SMF_HandleSet *handle_set)
     uint64_t ix = handle_set->data_len;
     handle_set->data_len++;
 
-    uint64_t id = handle_set->next_id + 1;
+    SMF_TrackHandleSetUsage((int64_t)handle_set->data_size);
+
+    uint64_t id = handle_set->next_id++;
 
     obj->handle = SMF_MAKE_HANDLE(handle_set->type, ix, id);
 
@@ -129,3 +160,23 @@ void *SMF_FindHandleObject(SMF_HandleSet *handle_set, uint64_t handle)
 
     return obj;
 }
+
+void SMF_DestroyHandle(SMF_HandleSet *handle_set, uint64_t handle)
+{
+    assert(handle_set);
+
+    SMF_HandleObject *obj = SMF_FindHandleObject(handle_set, handle);
+    if (!obj)
+    {
+        return;
+    }
+
+    handle_set->clean_cb(obj);
+
+    uint64_t ix = SMF_HANDLE_INDEX(handle);
+    memset(obj, 0, handle_set->data_size);
+    obj->next_free = handle_set->free_head;
+    handle_set->free_head = ix + 1;
+
+    SMF_TrackHandleSetUsage(-(int64_t)handle_set->data_size);
+}
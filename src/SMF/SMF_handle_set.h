@@ -9,12 +9,16 @@
 typedef enum SMF_HandleType
 {
     SMF_HANDLE_TYPE_IMAGE = 1,
-    SMF_HANDLE_TYPE_FONT
+    SMF_HANDLE_TYPE_FONT,
+    SMF_HANDLE_TYPE_LAYOUT,
+    SMF_HANDLE_TYPE_TEXT_GRID,
+    SMF_HANDLE_TYPE_NINE_SLICE
 } SMF_HandleType;
 
 typedef struct SMF_HandleObject
 {
     uint64_t handle;
+    uint64_t next_free;
 } SMF_HandleObject;
 
 #define SMF_MAKE_HANDLE(Type, Index, Id) ((Type & 0xff) | ((Index & 0xffffff) << 8) | ((Id & 0xffffffff) << 32))
@@ -30,6 +34,7 @@ typedef struct SMF_HandleSet
     uint64_t next_id;
     uint64_t data_cap;
     uint64_t data_len;
+    uint64_t free_head;
     char *data;
 } SMF_HandleSet;
 
@@ -38,3 +43,4 @@ void SMF_CleanHandleSet(SMF_HandleSet *handle_set);
 
 void *SMF_CreateHandle(SMF_HandleSet *handle_set);
 void *SMF_FindHandleObject(SMF_HandleSet *handle_set, uint64_t handle);
+void SMF_DestroyHandle(SMF_HandleSet *handle_set, uint64_t handle);
@@ -3,6 +3,8 @@
 
 #include <assert.h>
 
+#include "SMF/SMF.h"
+
 #include "SMF_hash_map.h"
 
 #include "SMF_mem.h"
@@ -26,6 +28,7 @@ typedef struct SMF_HashMap
 {
     uint64_t cap;
     uint64_t size;
+    uint64_t fill;
     SMF_HashMapSlot *slots;
 } SMF_HashMap;
 
@@ -45,6 +48,9 @@ SMF_HashMap *SMF_CreateHashMap(void)
         return NULL;
     }
 
+    SMF_TrackAlloc(SMF_MEMORY_HASH_MAPS, sizeof(SMF_HashMap));
+    SMF_TrackAlloc(SMF_MEMORY_HASH_MAPS, hash_map->cap * sizeof(SMF_HashMapSlot));
+
     return hash_map;
 }
 
@@ -52,6 +58,8 @@ void SMF_DestroyHashMap(SMF_HashMap *hash_map)
 {
     if (hash_map)
     {
+        SMF_TrackFree(SMF_MEMORY_HASH_MAPS, hash_map->cap * sizeof(SMF_HashMapSlot));
+        SMF_TrackFree(SMF_MEMORY_HASH_MAPS, sizeof(SMF_HashMap));
         SMF_Free(hash_map->slots);
         SMF_Free(hash_map);
     }
@@ -74,7 +82,7 @@ int SMF_FindHashMapEntry(SMF_HashMap *hash_map, uint64_t key, void **value)
         }
 
         perturb >>= PERTURB_SHIFT;
-        ix = (5 * ix) + 1 + perturb;
+        ix = ((5 * ix) + 1 + perturb) & mask;
     }
 
     return 0;
@@ -88,7 +96,12 @@ static void InsertIntoHashMap(SMF_HashMap *hash_map, uint64_t key, void *value)
     while (hash_map->slots[ix].use == USE_ACTIVE)
     {
         perturb >>= PERTURB_SHIFT;
-        ix = (5 * ix) + 1 + perturb;
+        ix = ((5 * ix) + 1 + perturb) & mask;
+    }
+
+    if (hash_map->slots[ix].use == USE_UNUSED)
+    {
+        hash_map->fill++;
     }
 
     hash_map->slots[ix].use = USE_ACTIVE;
@@ -97,9 +110,15 @@ static void InsertIntoHashMap(SMF_HashMap *hash_map, uint64_t key, void *value)
     hash_map->size++;
 }
 
-static int ExpandHashMap(SMF_HashMap *hash_map)
+static int RehashHashMap(SMF_HashMap *hash_map)
 {
-    uint64_t new_cap = hash_map->cap * 2;
+    // when most of the fill is erased slots, rehashing at the same capacity is enough to clear them out
+    uint64_t new_cap = hash_map->cap;
+    if (hash_map->size * 2 >= hash_map->cap)
+    {
+        new_cap = hash_map->cap * 2;
+    }
+
     SMF_HashMapSlot *new_slots = SMF_Calloc(new_cap, sizeof(SMF_HashMapSlot));
     if (!new_slots)
     {
@@ -112,6 +131,7 @@ static int ExpandHashMap(SMF_HashMap *hash_map)
     hash_map->cap = new_cap;
     hash_map->slots = new_slots;
     hash_map->size = 0;
+    hash_map->fill = 0;
 
     for (uint64_t ix = 0; ix < old_cap; ++ix)
     {
@@ -122,6 +142,10 @@ static int ExpandHashMap(SMF_HashMap *hash_map)
     }
 
     SMF_Free(old_slots);
+
+    SMF_TrackAlloc(SMF_MEMORY_HASH_MAPS, new_cap * sizeof(SMF_HashMapSlot));
+    SMF_TrackFree(SMF_MEMORY_HASH_MAPS, old_cap * sizeof(SMF_HashMapSlot));
+
     return 0;
 }
 
@@ -129,10 +153,11 @@ int SMF_InsertHashMapEntry(SMF_HashMap *hash_map, uint64_t key, void *value)
 {
     assert(hash_map);
 
-    double load_factor = (double)hash_map->size / (double)hash_map->cap;
+    // erased slots still lengthen probe sequences, so they count towards the load factor
+    double load_factor = (double)hash_map->fill / (double)hash_map->cap;
     if (load_factor >= MAX_LOAD_FACTOR)
     {
-        if (ExpandHashMap(hash_map) == -1)
+        if (RehashHashMap(hash_map) == -1)
         {
             return -1;
         }
@@ -141,3 +166,27 @@ int SMF_InsertHashMapEntry(SMF_HashMap *hash_map, uint64_t key, void *value)
     InsertIntoHashMap(hash_map, key, value);
     return 0;
 }
+
+int SMF_RemoveHashMapEntry(SMF_HashMap *hash_map, uint64_t key)
+{
+    assert(hash_map);
+
+    uint64_t mask = hash_map->cap - 1;
+    uint64_t perturb = key;
+    uint64_t ix = key & mask;
+    while (hash_map->slots[ix].use != USE_UNUSED)
+    {
+        if (hash_map->slots[ix].use == USE_ACTIVE && hash_map->slots[ix].key == key)
+        {
+            hash_map->slots[ix].use = USE_ERASED;
+            hash_map->slots[ix].value = NULL;
+            hash_map->size--;
+            return 1;
+        }
+
+        perturb >>= PERTURB_SHIFT;
+        ix = ((5 * ix) + 1 + perturb) & mask;
+    }
+
+    return 0;
+}
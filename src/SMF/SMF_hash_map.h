@@ -11,3 +11,4 @@ SMF_HashMap *SMF_CreateHashMap(void);
 void SMF_DestroyHashMap(SMF_HashMap *hash_map);
 int SMF_FindHashMapEntry(SMF_HashMap *hash_map, uint64_t key, void **value);
 int SMF_InsertHashMapEntry(SMF_HashMap *hash_map, uint64_t key, void *value);
+int SMF_RemoveHashMapEntry(SMF_HashMap *hash_map, uint64_t key);
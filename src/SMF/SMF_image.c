@@ -1,27 +1,98 @@
 // Copyright (c) 2024-present, Jason Hoyt
 // Distributed under the MIT License (http://opensource.org/licenses/MIT)
 
+#include <assert.h>
+#include <string.h>
+
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SMF_IMAGE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SMF_IMAGE_NEON
+#endif
+
 #include "SMF/SMF.h"
 
 #include "SMF_image.h"
 
 #include "SMF_context.h"
 #include "SMF_handle_set.h"
+#include "SMF_mem.h"
+#include "SMF_stream.h"
+#include "SMF_window.h"
 
 typedef struct SMF_Image
 {
     SMF_HandleObject base;
     SDL_Surface *surface;
+    SDL_Texture *texture;
+    SMF_MemorySubsystem subsystem;
+    int w, h;
+    int is_coverage;
+    int is_target;
+    int is_opaque;
 } SMF_Image;
 
+// a texture whose image was destroyed while render commands recorded this frame may still refer to it (in the frame
+// arena)
+typedef struct SMF_PendingTexture
+{
+    struct SMF_PendingTexture *next;
+    SDL_Texture *texture;
+} SMF_PendingTexture;
+
 static SMF_HandleSet g_images;
 
+// textures waiting for the render commands of the current frame to be executed before they are destroyed
+static SMF_PendingTexture *g_pending_textures = NULL;
+
+static void DestroyTextureLater(SDL_Texture *texture)
+{
+    SMF_PendingTexture *pending = SMF_FrameAlloc(sizeof(SMF_PendingTexture));
+    if (!pending)
+    {
+        // without memory to defer it the texture has to go now, this is only safe if nothing was drawn with it
+        SDL_DestroyTexture(texture);
+        return;
+    }
+
+    pending->texture = texture;
+    pending->next = g_pending_textures;
+    g_pending_textures = pending;
+}
+
+void SMF_DestroyPendingTextures(void)
+{
+    SMF_PendingTexture *pending = g_pending_textures;
+    while (pending)
+    {
+        SDL_DestroyTexture(pending->texture);
+        pending = pending->next;
+    }
+
+    g_pending_textures = NULL;
+}
+
 static void DestroyImage(void *data)
 {
     SMF_Image *img = (SMF_Image *)data;
+    if (img->texture)
+    {
+        DestroyTextureLater(img->texture);
+    }
+
+    // render targets only exist as a texture
+    if (img->is_target)
+    {
+        SMF_TrackFree(img->subsystem, (size_t)img->w * img->h * 4);
+        return;
+    }
+
+    SMF_TrackFree(img->subsystem, (size_t)img->surface->pitch * img->surface->h);
     SDL_FreeSurface(img->surface);
 }
 
@@ -33,6 +104,42 @@ int SMF_InitImages(void)
 void SMF_CleanImages(void)
 {
     SMF_CleanHandleSet(&g_images);
+    SMF_DestroyPendingTextures();
+}
+
+static SMF_Handle CreateImage(SDL_Surface *surface)
+{
+    SMF_Image *image = SMF_CreateHandle(&g_images);
+    if (!image)
+    {
+        SDL_FreeSurface(surface);
+        return SMF_INVALID_HANDLE;
+    }
+
+    image->surface = surface;
+    image->subsystem = SMF_MEMORY_IMAGE_SURFACES;
+    image->w = surface->w;
+    image->h = surface->h;
+    SMF_TrackAlloc(SMF_MEMORY_IMAGE_SURFACES, (size_t)surface->pitch * surface->h);
+
+    return image->base.handle;
+}
+
+static SMF_Handle LoadImageFromRW(SDL_RWops *rw)
+{
+    if (!rw)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    SDL_Surface *surface = IMG_Load_RW(rw, 1);
+    if (!surface)
+    {
+        SMF_SDLError();
+        return SMF_INVALID_HANDLE;
+    }
+
+    return CreateImage(surface);
 }
 
 SMF_Handle SMF_LoadImage(const char *path)
@@ -55,15 +162,28 @@ SMF_Handle SMF_LoadImage(const char *path)
         return SMF_INVALID_HANDLE;
     }
 
-    SMF_Image *image = SMF_CreateHandle(&g_images);
-    if (!image)
+    return CreateImage(surface);
+}
+
+SMF_Handle SMF_LoadImageFromMemory(const void *data, size_t size)
+{
+    if (SMF_IsInitialized() == -1)
     {
-        SDL_FreeSurface(surface);
         return SMF_INVALID_HANDLE;
     }
 
-    image->surface = surface;
-    return image->base.handle;
+    return LoadImageFromRW(SMF_CreateMemoryRW(data, size));
+}
+
+SMF_Handle SMF_LoadImageFromStream(const SMF_Stream *stream)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        SMF_CloseStream(stream);
+        return SMF_INVALID_HANDLE;
+    }
+
+    return LoadImageFromRW(SMF_CreateStreamRW(stream));
 }
 
 static int ValidateImageDef(const SMF_ImageDef *def, SDL_Surface *surface)
@@ -91,18 +211,8 @@ static int ValidateImageDef(const SMF_ImageDef *def, SDL_Surface *surface)
     return 0;
 }
 
-int SMF_LoadImageSet(const char *path, int count, const SMF_ImageDef *defs, SMF_Handle *handles)
+static int ValidateImageSetArgs(int count, const SMF_ImageDef *defs, SMF_Handle *handles)
 {
-    if (SMF_IsInitialized() == -1)
-    {
-        return -1;
-    }
-
-    if (!path)
-    {
-        return SMF_InvalidArgError("path");
-    }
-
     if (count <= 0)
     {
         return SMF_InvalidArgError("count");
@@ -118,12 +228,11 @@ int SMF_LoadImageSet(const char *path, int count, const SMF_ImageDef *defs, SMF_
         return SMF_InvalidArgError("handles");
     }
 
-    SDL_Surface *surface = IMG_Load(path);
-    if (!surface)
-    {
-        return SMF_SDLError();
-    }
+    return 0;
+}
 
+static int LoadImageSetFromSurface(SDL_Surface *surface, int count, const SMF_ImageDef *defs, SMF_Handle *handles)
+{
     memset(handles, 0, sizeof(SMF_Handle) * count);
 
     for (int ix = 0; ix < count; ++ix)
@@ -145,22 +254,96 @@ int SMF_LoadImageSet(const char *path, int count, const SMF_ImageDef *defs, SMF_
         SDL_Rect src = {defs[ix].x, defs[ix].y, defs[ix].w, defs[ix].h};
         SDL_BlitSurface(surface, &src, new_surface, NULL);
 
-        SMF_Image *img = SMF_CreateHandle(&g_images);
-        if (!img)
+        handles[ix] = CreateImage(new_surface);
+        if (handles[ix] == SMF_INVALID_HANDLE)
         {
-            SDL_FreeSurface(new_surface);
             SDL_FreeSurface(surface);
             return -1;
         }
 
-        img->surface = new_surface;
-        handles[ix] = img->base.handle;
+        // the sprite keeps the size of its def, which is what SMF_GetImageSize and the draw commands use
+        assert(((SMF_Image *)SMF_FindHandleObject(&g_images, handles[ix]))->w == defs[ix].w);
+        assert(((SMF_Image *)SMF_FindHandleObject(&g_images, handles[ix]))->h == defs[ix].h);
     }
 
     SDL_FreeSurface(surface);
     return 0;
 }
 
+static int LoadImageSetFromRW(SDL_RWops *rw, int count, const SMF_ImageDef *defs, SMF_Handle *handles)
+{
+    if (!rw)
+    {
+        return -1;
+    }
+
+    SDL_Surface *surface = IMG_Load_RW(rw, 1);
+    if (!surface)
+    {
+        return SMF_SDLError();
+    }
+
+    return LoadImageSetFromSurface(surface, count, defs, handles);
+}
+
+int SMF_LoadImageSet(const char *path, int count, const SMF_ImageDef *defs, SMF_Handle *handles)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!path)
+    {
+        return SMF_InvalidArgError("path");
+    }
+
+    if (ValidateImageSetArgs(count, defs, handles) == -1)
+    {
+        return -1;
+    }
+
+    SDL_Surface *surface = IMG_Load(path);
+    if (!surface)
+    {
+        return SMF_SDLError();
+    }
+
+    return LoadImageSetFromSurface(surface, count, defs, handles);
+}
+
+int SMF_LoadImageSetFromMemory(const void *data, size_t size, int count, const SMF_ImageDef *defs, SMF_Handle *handles)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (ValidateImageSetArgs(count, defs, handles) == -1)
+    {
+        return -1;
+    }
+
+    return LoadImageSetFromRW(SMF_CreateMemoryRW(data, size), count, defs, handles);
+}
+
+int SMF_LoadImageSetFromStream(const SMF_Stream *stream, int count, const SMF_ImageDef *defs, SMF_Handle *handles)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        SMF_CloseStream(stream);
+        return -1;
+    }
+
+    if (ValidateImageSetArgs(count, defs, handles) == -1)
+    {
+        SMF_CloseStream(stream);
+        return -1;
+    }
+
+    return LoadImageSetFromRW(SMF_CreateStreamRW(stream), count, defs, handles);
+}
+
 int SMF_GetImageSize(SMF_Handle image, int *w, int *h)
 {
     if (SMF_IsInitialized() == -1)
@@ -176,12 +359,12 @@ int SMF_GetImageSize(SMF_Handle image, int *w, int *h)
 
     if (w)
     {
-        *w = img->surface->w;
+        *w = img->w;
     }
 
     if (h)
     {
-        *h = img->surface->h;
+        *h = img->h;
     }
 
     return 0;
@@ -198,7 +381,224 @@ SDL_Surface *SMF_GetImageSurface(uint64_t handle)
     return image->surface;
 }
 
-SMF_Handle SMF_CreateImageFromSurface(SDL_Surface *surface)
+// white pixels with the coverage as alpha, the tint is applied by the texture color modulation
+static void ExpandCoverage(const uint8_t *src, uint32_t *dst, size_t count)
+{
+    size_t ix = 0;
+
+#if defined(SMF_IMAGE_SSE2)
+    const __m128i white = _mm_set1_epi8((char)0xff);
+    for (; ix + 16 <= count; ix += 16)
+    {
+        __m128i coverage = _mm_loadu_si128((const __m128i *)(src + ix));
+        __m128i lo = _mm_unpacklo_epi8(white, coverage);
+        __m128i hi = _mm_unpackhi_epi8(white, coverage);
+        _mm_storeu_si128((__m128i *)(dst + ix), _mm_unpacklo_epi16(white, lo));
+        _mm_storeu_si128((__m128i *)(dst + ix + 4), _mm_unpackhi_epi16(white, lo));
+        _mm_storeu_si128((__m128i *)(dst + ix + 8), _mm_unpacklo_epi16(white, hi));
+        _mm_storeu_si128((__m128i *)(dst + ix + 12), _mm_unpackhi_epi16(white, hi));
+    }
+#elif defined(SMF_IMAGE_NEON)
+    uint8x16x4_t pixels;
+    pixels.val[0] = vdupq_n_u8(0xff);
+    pixels.val[1] = vdupq_n_u8(0xff);
+    pixels.val[2] = vdupq_n_u8(0xff);
+    for (; ix + 16 <= count; ix += 16)
+    {
+        pixels.val[3] = vld1q_u8(src + ix);
+        vst4q_u8((uint8_t *)(dst + ix), pixels);
+    }
+#endif
+
+    for (; ix < count; ++ix)
+    {
+        dst[ix] = ((uint32_t)src[ix] << 24) | 0x00ffffff;
+    }
+}
+
+// SDL_Renderer has no alpha-only texture format, so coverage is only expanded to 32 bits on the way to the GPU
+static SDL_Texture *CreateCoverageTexture(SDL_Surface *surface)
+{
+    int w = surface->w;
+    int h = surface->h;
+
+    uint32_t *pixels = SMF_Calloc((size_t)w * h, sizeof(uint32_t));
+    if (!pixels)
+    {
+        return NULL;
+    }
+
+    for (int y = 0; y < h; ++y)
+    {
+        ExpandCoverage((const uint8_t *)surface->pixels + (size_t)y * surface->pitch, pixels + (size_t)y * w, w);
+    }
+
+    SDL_Texture *texture =
+        SDL_CreateTexture(SMF_GetRenderer(), SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, w, h);
+    if (!texture || SDL_UpdateTexture(texture, NULL, pixels, w * (int)sizeof(uint32_t)) == -1)
+    {
+        SMF_SDLError();
+        if (texture)
+        {
+            SDL_DestroyTexture(texture);
+        }
+        SMF_Free(pixels);
+        return NULL;
+    }
+
+    SMF_Free(pixels);
+
+    return texture;
+}
+
+SDL_Texture *SMF_GetImageTexture(uint64_t handle, int *w, int *h)
+{
+    SMF_Image *image = SMF_FindHandleObject(&g_images, handle);
+    if (!image)
+    {
+        return NULL;
+    }
+
+    if (!image->texture)
+    {
+        if (image->is_coverage)
+        {
+            image->texture = CreateCoverageTexture(image->surface);
+        }
+        else
+        {
+            image->texture = SDL_CreateTextureFromSurface(SMF_GetRenderer(), image->surface);
+
+            // without an alpha channel or a color key every pixel of the texture ends up opaque
+            SDL_PixelFormat *format = image->surface->format;
+            image->is_opaque =
+                !format->Amask && !SDL_ISPIXELFORMAT_INDEXED(format->format) && !SDL_HasColorKey(image->surface);
+        }
+
+        if (!image->texture)
+        {
+            SMF_SDLError();
+            return NULL;
+        }
+
+        SDL_SetTextureBlendMode(image->texture, SDL_BLENDMODE_BLEND);
+    }
+
+    *w = image->w;
+    *h = image->h;
+
+    return image->texture;
+}
+
+int SMF_IsImageOpaque(uint64_t handle)
+{
+    SMF_Image *image = SMF_FindHandleObject(&g_images, handle);
+    return image && image->is_opaque;
+}
+
+// the palette keeps coverage surfaces meaningful to SDL (each index is white at that opacity)
+static int SetCoveragePalette(SDL_Surface *surface)
+{
+    SDL_Color colors[256];
+    for (int ix = 0; ix < 256; ++ix)
+    {
+        colors[ix].r = 255;
+        colors[ix].g = 255;
+        colors[ix].b = 255;
+        colors[ix].a = (Uint8)ix;
+    }
+
+    if (SDL_SetPaletteColors(surface->format->palette, colors, 0, 256) == -1)
+    {
+        return SMF_SDLError();
+    }
+
+    return 0;
+}
+
+SDL_Surface *SMF_CreateCoverageSurface(int w, int h)
+{
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 8, SDL_PIXELFORMAT_INDEX8);
+    if (!surface)
+    {
+        SMF_SDLError();
+        return NULL;
+    }
+
+    if (SetCoveragePalette(surface) == -1)
+    {
+        SDL_FreeSurface(surface);
+        return NULL;
+    }
+
+    return surface;
+}
+
+SDL_Surface *SMF_ConvertToCoverage(SDL_Surface *surface)
+{
+    if (!surface->format->Amask || SDL_LockSurface(surface) == -1)
+    {
+        return NULL;
+    }
+
+    // only surfaces whose visible pixels are all white lose nothing by keeping just their alpha
+    int is_white = 1;
+    for (int y = 0; y < surface->h && is_white; ++y)
+    {
+        const Uint8 *row = (const Uint8 *)surface->pixels + (size_t)y * surface->pitch;
+        for (int x = 0; x < surface->w && is_white; ++x)
+        {
+            Uint32 pixel = 0;
+            memcpy(&pixel, row + x * surface->format->BytesPerPixel, surface->format->BytesPerPixel);
+
+            Uint8 r, g, b, a;
+            SDL_GetRGBA(pixel, surface->format, &r, &g, &b, &a);
+            is_white = a == 0 || (r == 255 && g == 255 && b == 255);
+        }
+    }
+
+    SDL_Surface *coverage = is_white ? SMF_CreateCoverageSurface(surface->w, surface->h) : NULL;
+    if (coverage)
+    {
+        for (int y = 0; y < surface->h; ++y)
+        {
+            const Uint8 *row = (const Uint8 *)surface->pixels + (size_t)y * surface->pitch;
+            Uint8 *dst = (Uint8 *)coverage->pixels + (size_t)y * coverage->pitch;
+            for (int x = 0; x < surface->w; ++x)
+            {
+                Uint32 pixel = 0;
+                memcpy(&pixel, row + x * surface->format->BytesPerPixel, surface->format->BytesPerPixel);
+
+                Uint8 r, g, b;
+                SDL_GetRGBA(pixel, surface->format, &r, &g, &b, dst + x);
+            }
+        }
+    }
+
+    SDL_UnlockSurface(surface);
+
+    return coverage;
+}
+
+SMF_Handle SMF_CreateCoverageImage(SDL_Surface *surface, SMF_MemorySubsystem subsystem)
+{
+    if (surface->format->format != SDL_PIXELFORMAT_INDEX8 || SetCoveragePalette(surface) == -1)
+    {
+        SMF_SetError("surface is not 8-bit coverage");
+        return SMF_INVALID_HANDLE;
+    }
+
+    SMF_Handle handle = SMF_CreateImageFromSurface(surface, subsystem);
+    if (handle != SMF_INVALID_HANDLE)
+    {
+        SMF_Image *image = SMF_FindHandleObject(&g_images, handle);
+        image->is_coverage = 1;
+    }
+
+    return handle;
+}
+
+SMF_Handle SMF_CreateImageFromSurface(SDL_Surface *surface, SMF_MemorySubsystem subsystem)
 {
     SMF_Image *image = SMF_CreateHandle(&g_images);
     if (!image)
@@ -207,5 +607,96 @@ SMF_Handle SMF_CreateImageFromSurface(SDL_Surface *surface)
     }
 
     image->surface = surface;
+    image->subsystem = subsystem;
+    image->w = surface->w;
+    image->h = surface->h;
+    SMF_TrackAlloc(subsystem, (size_t)surface->pitch * surface->h);
+
     return image->base.handle;
 }
+
+SMF_Handle SMF_CreateRenderTarget(int w, int h)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    if (w <= 0)
+    {
+        SMF_InvalidArgError("w");
+        return SMF_INVALID_HANDLE;
+    }
+
+    if (h <= 0)
+    {
+        SMF_InvalidArgError("h");
+        return SMF_INVALID_HANDLE;
+    }
+
+    SDL_Renderer *renderer = SMF_GetRenderer();
+    if (!SDL_RenderTargetSupported(renderer))
+    {
+        SMF_SetError("renderer does not support render targets");
+        return SMF_INVALID_HANDLE;
+    }
+
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!texture)
+    {
+        SMF_SDLError();
+        return SMF_INVALID_HANDLE;
+    }
+
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    // the contents of a new target are undefined, so start out transparent
+    SDL_Texture *prev_target = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, texture);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    SDL_SetRenderTarget(renderer, prev_target);
+
+    SMF_Image *image = SMF_CreateHandle(&g_images);
+    if (!image)
+    {
+        SDL_DestroyTexture(texture);
+        return SMF_INVALID_HANDLE;
+    }
+
+    image->texture = texture;
+    image->subsystem = SMF_MEMORY_IMAGE_SURFACES;
+    image->w = w;
+    image->h = h;
+    image->is_target = 1;
+    SMF_TrackAlloc(SMF_MEMORY_IMAGE_SURFACES, (size_t)w * h * 4);
+
+    return image->base.handle;
+}
+
+SDL_Texture *SMF_GetRenderTargetTexture(uint64_t handle)
+{
+    SMF_Image *image = SMF_FindHandleObject(&g_images, handle);
+    if (!image)
+    {
+        return NULL;
+    }
+
+    if (!image->is_target)
+    {
+        SMF_SetError("image is not a render target");
+        return NULL;
+    }
+
+    return image->texture;
+}
+
+void SMF_DestroyImage(uint64_t handle)
+{
+    SMF_DestroyHandle(&g_images, handle);
+}
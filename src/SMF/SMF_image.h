@@ -6,4 +6,12 @@
 int SMF_InitImages(void);
 void SMF_CleanImages(void);
 SDL_Surface *SMF_GetImageSurface(uint64_t handle);
-SMF_Handle SMF_CreateImageFromSurface(SDL_Surface *surface);
+SDL_Texture *SMF_GetImageTexture(uint64_t handle, int *w, int *h);
+int SMF_IsImageOpaque(uint64_t handle);
+SDL_Texture *SMF_GetRenderTargetTexture(uint64_t handle);
+SMF_Handle SMF_CreateImageFromSurface(SDL_Surface *surface, SMF_MemorySubsystem subsystem);
+SDL_Surface *SMF_CreateCoverageSurface(int w, int h);
+SDL_Surface *SMF_ConvertToCoverage(SDL_Surface *surface);
+SMF_Handle SMF_CreateCoverageImage(SDL_Surface *surface, SMF_MemorySubsystem subsystem);
+void SMF_DestroyImage(uint64_t handle);
+void SMF_DestroyPendingTextures(void);
@@ -0,0 +1,283 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <stdint.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_input.h"
+
+#include "SMF_render.h"
+#include "SMF_replay.h"
+#include "SMF_window.h"
+
+// keys are indexed by their key code, where key codes without the scancode mask (the printable keys) take the
+// lower half and key codes with it (arrows, function keys, ...) take the upper half by their scancode
+#define SMF_INPUT_KEY_HALF 512
+#define SMF_INPUT_KEY_COUNT (SMF_INPUT_KEY_HALF * 2)
+#define SMF_INPUT_KEY_WORDS (SMF_INPUT_KEY_COUNT / 64)
+
+typedef struct SMF_InputState
+{
+    uint64_t keys_down[SMF_INPUT_KEY_WORDS];
+    uint64_t keys_pressed[SMF_INPUT_KEY_WORDS];
+    uint32_t buttons_down;
+    uint32_t buttons_pressed;
+    int mouse_x, mouse_y;
+    int scroll_x, scroll_y;
+} SMF_InputState;
+
+static SMF_InputState g_input;
+
+// the frame the pressed bits and the scroll were accumulated for (they start over once a frame has been presented)
+static uint64_t g_input_frame = UINT64_MAX;
+
+static int KeyIndex(int key)
+{
+    if ((key & SDLK_SCANCODE_MASK) != 0)
+    {
+        key &= ~SDLK_SCANCODE_MASK;
+        return key >= 0 && key < SMF_INPUT_KEY_HALF ? SMF_INPUT_KEY_HALF + key : -1;
+    }
+
+    return key >= 0 && key < SMF_INPUT_KEY_HALF ? key : -1;
+}
+
+static uint32_t MapMouseButtons(uint32_t sdl_buttons)
+{
+    uint32_t out = 0;
+
+    if ((sdl_buttons & SDL_BUTTON_LMASK) != 0)
+    {
+        out |= 1u << SMF_MOUSE_BUTTON_LEFT;
+    }
+
+    if ((sdl_buttons & SDL_BUTTON_RMASK) != 0)
+    {
+        out |= 1u << SMF_MOUSE_BUTTON_RIGHT;
+    }
+
+    if ((sdl_buttons & SDL_BUTTON_MMASK) != 0)
+    {
+        out |= 1u << SMF_MOUSE_BUTTON_MIDDLE;
+    }
+
+    return out;
+}
+
+static void BeginInputFrame(void)
+{
+    uint64_t frame = SMF_GetFrameNumber();
+    if (frame == g_input_frame)
+    {
+        return;
+    }
+
+    g_input_frame = frame;
+    memset(g_input.keys_pressed, 0, sizeof(g_input.keys_pressed));
+    g_input.buttons_pressed = 0;
+    g_input.scroll_x = 0;
+    g_input.scroll_y = 0;
+}
+
+void SMF_UpdateInputState(void)
+{
+    BeginInputFrame();
+
+    // a replay has no real keyboard or mouse behind it, so its state comes from the replayed events alone
+    if (SMF_IsReplaying())
+    {
+        return;
+    }
+
+    int num_keys = 0;
+    const Uint8 *keyboard = SDL_GetKeyboardState(&num_keys);
+
+    uint64_t keys_down[SMF_INPUT_KEY_WORDS];
+    memset(keys_down, 0, sizeof(keys_down));
+    for (int scancode = 0; scancode < num_keys; ++scancode)
+    {
+        if (keyboard[scancode])
+        {
+            int ix = KeyIndex(SDL_GetKeyFromScancode((SDL_Scancode)scancode));
+            if (ix >= 0)
+            {
+                keys_down[ix / 64] |= (uint64_t)1 << (ix % 64);
+            }
+        }
+    }
+
+    for (int ix = 0; ix < SMF_INPUT_KEY_WORDS; ++ix)
+    {
+        g_input.keys_pressed[ix] |= keys_down[ix] & ~g_input.keys_down[ix];
+        g_input.keys_down[ix] = keys_down[ix];
+    }
+
+    int x = 0;
+    int y = 0;
+    uint32_t buttons = MapMouseButtons(SDL_GetMouseState(&x, &y));
+    g_input.buttons_pressed |= buttons & ~g_input.buttons_down;
+    g_input.buttons_down = buttons;
+
+    int scale = SMF_GetWindowScale();
+    g_input.mouse_x = x / scale;
+    g_input.mouse_y = y / scale;
+}
+
+void SMF_TrackInputEvent(const SDL_Event *e)
+{
+    // the bulk update only sees the state after all queued events, so presses that were released again before the
+    // update (such as a quick tap) and the scroll come from the events themselves
+    switch (e->type)
+    {
+    case SDL_KEYDOWN: {
+        int ix = KeyIndex(e->key.keysym.sym);
+        if (ix >= 0 && !e->key.repeat)
+        {
+            BeginInputFrame();
+            g_input.keys_pressed[ix / 64] |= (uint64_t)1 << (ix % 64);
+        }
+        break;
+    }
+    case SDL_MOUSEBUTTONDOWN:
+        BeginInputFrame();
+        g_input.buttons_pressed |= MapMouseButtons(SDL_BUTTON(e->button.button));
+        break;
+    case SDL_MOUSEWHEEL:
+        BeginInputFrame();
+        g_input.scroll_x += e->wheel.x;
+        g_input.scroll_y += e->wheel.y;
+        break;
+    default:
+        break;
+    }
+}
+
+static void SetKey(int key, int is_down)
+{
+    int ix = KeyIndex(key);
+    if (ix < 0)
+    {
+        return;
+    }
+
+    uint64_t bit = (uint64_t)1 << (ix % 64);
+    if (is_down)
+    {
+        g_input.keys_pressed[ix / 64] |= bit & ~g_input.keys_down[ix / 64];
+        g_input.keys_down[ix / 64] |= bit;
+    }
+    else
+    {
+        g_input.keys_down[ix / 64] &= ~bit;
+    }
+}
+
+static void SetMouseButton(SMF_MouseButton button, int is_down)
+{
+    uint32_t bit = 1u << button;
+    if (is_down)
+    {
+        g_input.buttons_pressed |= bit & ~g_input.buttons_down;
+        g_input.buttons_down |= bit;
+    }
+    else
+    {
+        g_input.buttons_down &= ~bit;
+    }
+}
+
+void SMF_ApplyReplayedEvent(const SMF_Event *event)
+{
+    BeginInputFrame();
+
+    switch (event->type)
+    {
+    case SMF_EVENT_TYPE_MOUSE_ENTER:
+        g_input.mouse_x = event->mouse_enter.x;
+        g_input.mouse_y = event->mouse_enter.y;
+        break;
+    case SMF_EVENT_TYPE_MOUSE_MOVE:
+        g_input.mouse_x = event->mouse_move.x;
+        g_input.mouse_y = event->mouse_move.y;
+        break;
+    case SMF_EVENT_TYPE_MOUSE_PRESS:
+    case SMF_EVENT_TYPE_MOUSE_RELEASE: {
+        SMF_MouseButton button = event->mouse_button.button;
+        if (button >= SMF_MOUSE_BUTTON_LEFT && button <= SMF_MOUSE_BUTTON_MIDDLE)
+        {
+            SetMouseButton(button, event->type == SMF_EVENT_TYPE_MOUSE_PRESS);
+        }
+
+        g_input.mouse_x = event->mouse_button.x;
+        g_input.mouse_y = event->mouse_button.y;
+        break;
+    }
+    case SMF_EVENT_TYPE_MOUSE_SCROLL:
+        g_input.scroll_x += event->mouse_scroll.scroll_x;
+        g_input.scroll_y += event->mouse_scroll.scroll_y;
+        break;
+    case SMF_EVENT_TYPE_KEY_DOWN:
+    case SMF_EVENT_TYPE_KEY_UP:
+        SetKey(event->key.key, event->type == SMF_EVENT_TYPE_KEY_DOWN);
+        break;
+    default:
+        break;
+    }
+}
+
+int SMF_IsKeyDown(SMF_Key key)
+{
+    int ix = KeyIndex(key);
+    return ix >= 0 && (g_input.keys_down[ix / 64] & ((uint64_t)1 << (ix % 64))) != 0;
+}
+
+int SMF_IsKeyPressed(SMF_Key key)
+{
+    int ix = KeyIndex(key);
+    return ix >= 0 && g_input_frame == SMF_GetFrameNumber() &&
+           (g_input.keys_pressed[ix / 64] & ((uint64_t)1 << (ix % 64))) != 0;
+}
+
+int SMF_IsMouseButtonDown(SMF_MouseButton button)
+{
+    return button >= SMF_MOUSE_BUTTON_LEFT && button <= SMF_MOUSE_BUTTON_MIDDLE &&
+           (g_input.buttons_down & (1u << button)) != 0;
+}
+
+int SMF_IsMouseButtonPressed(SMF_MouseButton button)
+{
+    return button >= SMF_MOUSE_BUTTON_LEFT && button <= SMF_MOUSE_BUTTON_MIDDLE &&
+           g_input_frame == SMF_GetFrameNumber() && (g_input.buttons_pressed & (1u << button)) != 0;
+}
+
+void SMF_GetMousePosition(int *x, int *y)
+{
+    if (x)
+    {
+        *x = g_input.mouse_x;
+    }
+
+    if (y)
+    {
+        *y = g_input.mouse_y;
+    }
+}
+
+void SMF_GetMouseScroll(int *x, int *y)
+{
+    int is_current = g_input_frame == SMF_GetFrameNumber();
+
+    if (x)
+    {
+        *x = is_current ? g_input.scroll_x : 0;
+    }
+
+    if (y)
+    {
+        *y = is_current ? g_input.scroll_y : 0;
+    }
+}
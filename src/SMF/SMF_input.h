@@ -0,0 +1,8 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+void SMF_UpdateInputState(void);
+void SMF_TrackInputEvent(const SDL_Event *e);
+void SMF_ApplyReplayedEvent(const SMF_Event *event);
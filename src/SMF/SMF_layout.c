@@ -0,0 +1,593 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_layout.h"
+
+#include "SMF_context.h"
+#include "SMF_font.h"
+#include "SMF_handle_set.h"
+#include "SMF_mem.h"
+#include "SMF_utf8.h"
+
+// a single wrapped line, the text it covers runs from offset to the offset of the next line (len excludes the
+// whitespace the line was broken at)
+typedef struct SMF_LayoutLine
+{
+    uint32_t offset;
+    uint32_t len;
+    int width;
+} SMF_LayoutLine;
+
+typedef struct SMF_Layout
+{
+    SMF_HandleObject base;
+    SMF_Handle font;
+    int max_width;
+    int width;
+    char *text;
+    size_t text_len;
+    SMF_LayoutLine *lines;
+    size_t lines_len;
+    size_t lines_cap;
+} SMF_Layout;
+
+// a place the current line can be broken at (the line content ends at end and the next line starts at next)
+typedef struct SMF_LineBreak
+{
+    size_t end;
+    size_t next;
+    int width;
+} SMF_LineBreak;
+
+static SMF_HandleSet g_layouts;
+
+static void DestroyLayout(void *data)
+{
+    SMF_Layout *layout = (SMF_Layout *)data;
+    if (layout->text)
+    {
+        SMF_TrackFree(SMF_MEMORY_TEXT_LAYOUTS, layout->text_len + 1);
+        SMF_Free(layout->text);
+    }
+    if (layout->lines)
+    {
+        SMF_TrackFree(SMF_MEMORY_TEXT_LAYOUTS, layout->lines_cap * sizeof(SMF_LayoutLine));
+        SMF_Free(layout->lines);
+    }
+}
+
+int SMF_InitLayouts(void)
+{
+    return SMF_InitHandleSet(&g_layouts, SMF_HANDLE_TYPE_LAYOUT, sizeof(SMF_Layout), DestroyLayout);
+}
+
+void SMF_CleanLayouts(void)
+{
+    SMF_CleanHandleSet(&g_layouts);
+}
+
+static int IsSpace(uint32_t glyph)
+{
+    return glyph == ' ' || glyph == '\t';
+}
+
+// ideographic scripts are written without spaces and can be broken between any two characters
+static int IsIdeographic(uint32_t glyph)
+{
+    return (glyph >= 0x2E80 && glyph <= 0x9FFF) || (glyph >= 0xAC00 && glyph <= 0xD7AF) ||
+           (glyph >= 0xF900 && glyph <= 0xFAFF) || (glyph >= 0xFF00 && glyph <= 0xFFEF) ||
+           (glyph >= 0x20000 && glyph <= 0x3FFFF);
+}
+
+static int FitsWidth(SMF_Font *font, int max_width, int width)
+{
+    return max_width <= 0 || SMF_ScaleFontUnits(font, width) <= max_width;
+}
+
+// greedily fits as much text as possible from start onto one line and returns the start of the next line
+static size_t WrapLine(SMF_Font *font, int max_width, const char *text, size_t len, size_t start,
+                       SMF_LayoutLine *line, int *is_newline)
+{
+    SMF_LineBreak brk = {0, 0, 0};
+    int has_break = 0;
+
+    int width = 0;
+    uint32_t prev = 0;
+
+    // the spaces a line is broken at hang past the edge, so they never cause a wrap
+    int in_space = 0;
+    size_t space_start = 0;
+    int space_width = 0;
+
+    *is_newline = 0;
+
+    size_t pos = start;
+    while (pos < len)
+    {
+        size_t glyph_start = pos;
+        uint32_t glyph = (uint8_t)text[pos];
+        if (glyph < 0x80)
+        {
+            pos++;
+        }
+        else
+        {
+            glyph = SMF_DecodeUTF8(text, len, &pos);
+        }
+
+        if (glyph == '\n')
+        {
+            *is_newline = 1;
+            line->offset = (uint32_t)start;
+            line->len = (uint32_t)((in_space ? space_start : glyph_start) - start);
+            line->width = SMF_ScaleFontUnits(font, in_space ? space_width : width);
+            return pos;
+        }
+
+        int advance = SMF_GetGlyphAdvance(font, prev, glyph);
+
+        if (IsSpace(glyph))
+        {
+            if (!in_space)
+            {
+                in_space = 1;
+                space_start = glyph_start;
+                space_width = width;
+            }
+
+            width += advance;
+            prev = glyph;
+            continue;
+        }
+
+        if (in_space)
+        {
+            brk.end = space_start;
+            brk.next = glyph_start;
+            brk.width = space_width;
+            has_break = 1;
+            in_space = 0;
+        }
+        else if (glyph_start > start && (prev == '-' || IsIdeographic(prev) || IsIdeographic(glyph)))
+        {
+            brk.end = glyph_start;
+            brk.next = glyph_start;
+            brk.width = width;
+            has_break = 1;
+        }
+
+        if (glyph_start > start && !FitsWidth(font, max_width, width + advance))
+        {
+            // a word that is wider than the line on its own is broken wherever it overflows
+            if (!has_break)
+            {
+                brk.end = glyph_start;
+                brk.next = glyph_start;
+                brk.width = width;
+            }
+
+            line->offset = (uint32_t)start;
+            line->len = (uint32_t)(brk.end - start);
+            line->width = SMF_ScaleFontUnits(font, brk.width);
+            return brk.next;
+        }
+
+        width += advance;
+        prev = glyph;
+    }
+
+    line->offset = (uint32_t)start;
+    line->len = (uint32_t)((in_space ? space_start : len) - start);
+    line->width = SMF_ScaleFontUnits(font, in_space ? space_width : width);
+    return len;
+}
+
+static int AddLine(SMF_LayoutLine **lines, size_t *lines_len, size_t *lines_cap, const SMF_LayoutLine *line)
+{
+    if (*lines_len == *lines_cap)
+    {
+        size_t new_cap = *lines_cap == 0 ? 16 : *lines_cap * 2;
+        SMF_LayoutLine *new_lines = SMF_Calloc(new_cap, sizeof(SMF_LayoutLine));
+        if (!new_lines)
+        {
+            return -1;
+        }
+
+        if (*lines)
+        {
+            memcpy(new_lines, *lines, *lines_len * sizeof(SMF_LayoutLine));
+            SMF_TrackFree(SMF_MEMORY_TEXT_LAYOUTS, *lines_cap * sizeof(SMF_LayoutLine));
+            SMF_Free(*lines);
+        }
+
+        SMF_TrackAlloc(SMF_MEMORY_TEXT_LAYOUTS, new_cap * sizeof(SMF_LayoutLine));
+
+        *lines = new_lines;
+        *lines_cap = new_cap;
+    }
+
+    (*lines)[*lines_len] = *line;
+    (*lines_len)++;
+
+    return 0;
+}
+
+// finds the old line that starts exactly at offset (the lines are sorted by offset)
+static size_t FindLineStart(const SMF_LayoutLine *lines, size_t lines_len, size_t offset)
+{
+    size_t lo = 0;
+    size_t hi = lines_len;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (lines[mid].offset < offset)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo < lines_len && lines[lo].offset == offset ? lo : lines_len;
+}
+
+// finds the line containing offset
+static size_t FindLine(const SMF_LayoutLine *lines, size_t lines_len, size_t offset)
+{
+    size_t lo = 0;
+    size_t hi = lines_len;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (lines[mid].offset <= offset)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo > 0 ? lo - 1 : 0;
+}
+
+// wraps the new text from the start of line first_line on, reusing the old lines before it and, once the wrapping
+// reaches the unchanged end of the text at an old line start, the old lines after it
+static int Relayout(SMF_Layout *layout, SMF_Font *font, char *text, size_t len, size_t first_line, size_t suffix_len)
+{
+    SMF_LayoutLine *lines = NULL;
+    size_t lines_len = 0;
+    size_t lines_cap = 0;
+
+    for (size_t ix = 0; ix < first_line; ++ix)
+    {
+        if (AddLine(&lines, &lines_len, &lines_cap, layout->lines + ix) == -1)
+        {
+            goto error;
+        }
+    }
+
+    int64_t delta = (int64_t)len - (int64_t)layout->text_len;
+    size_t suffix_start = len - suffix_len;
+
+    size_t pos = first_line < layout->lines_len ? layout->lines[first_line].offset : 0;
+    for (;;)
+    {
+        SMF_LayoutLine line;
+        int is_newline = 0;
+        size_t next = WrapLine(font, layout->max_width, text, len, pos, &line, &is_newline);
+
+        if (AddLine(&lines, &lines_len, &lines_cap, &line) == -1)
+        {
+            goto error;
+        }
+
+        if (next == len && !is_newline)
+        {
+            break;
+        }
+
+        // wrapping only depends on the text from the start of a line on, so past the edit the old lines are valid
+        if (next > pos && next >= suffix_start && layout->lines)
+        {
+            size_t old = FindLineStart(layout->lines, layout->lines_len, (size_t)((int64_t)next - delta));
+            if (old > first_line && old < layout->lines_len)
+            {
+                for (; old < layout->lines_len; ++old)
+                {
+                    SMF_LayoutLine moved = layout->lines[old];
+                    moved.offset = (uint32_t)((int64_t)moved.offset + delta);
+                    if (AddLine(&lines, &lines_len, &lines_cap, &moved) == -1)
+                    {
+                        goto error;
+                    }
+                }
+                break;
+            }
+        }
+
+        pos = next;
+    }
+
+    if (layout->lines)
+    {
+        SMF_TrackFree(SMF_MEMORY_TEXT_LAYOUTS, layout->lines_cap * sizeof(SMF_LayoutLine));
+        SMF_Free(layout->lines);
+    }
+
+    layout->lines = lines;
+    layout->lines_len = lines_len;
+    layout->lines_cap = lines_cap;
+
+    if (layout->text)
+    {
+        SMF_TrackFree(SMF_MEMORY_TEXT_LAYOUTS, layout->text_len + 1);
+        SMF_Free(layout->text);
+    }
+
+    layout->text = text;
+    layout->text_len = len;
+
+    layout->width = 0;
+    for (size_t ix = 0; ix < lines_len; ++ix)
+    {
+        if (lines[ix].width > layout->width)
+        {
+            layout->width = lines[ix].width;
+        }
+    }
+
+    return 0;
+
+error:
+    if (lines)
+    {
+        SMF_TrackFree(SMF_MEMORY_TEXT_LAYOUTS, lines_cap * sizeof(SMF_LayoutLine));
+        SMF_Free(lines);
+    }
+
+    return -1;
+}
+
+static char *CopyText(const char *text, size_t len)
+{
+    char *copy = SMF_Calloc(len + 1, 1);
+    if (!copy)
+    {
+        return NULL;
+    }
+
+    memcpy(copy, text, len);
+    SMF_TrackAlloc(SMF_MEMORY_TEXT_LAYOUTS, len + 1);
+
+    return copy;
+}
+
+static void FreeText(char *text, size_t len)
+{
+    SMF_TrackFree(SMF_MEMORY_TEXT_LAYOUTS, len + 1);
+    SMF_Free(text);
+}
+
+int SMF_LayoutText(SMF_Handle font, const char *text, int max_width, SMF_Handle *out_layout)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!text)
+    {
+        return SMF_InvalidArgError("text");
+    }
+
+    if (!out_layout)
+    {
+        return SMF_InvalidArgError("out_layout");
+    }
+
+    size_t len = strlen(text);
+    if (len >= UINT32_MAX)
+    {
+        return SMF_InvalidArgError("text");
+    }
+
+    SMF_Font *data = SMF_GetFont(font);
+    if (!data)
+    {
+        return -1;
+    }
+
+    char *copy = CopyText(text, len);
+    if (!copy)
+    {
+        return -1;
+    }
+
+    SMF_Layout *layout = SMF_CreateHandle(&g_layouts);
+    if (!layout)
+    {
+        FreeText(copy, len);
+        return -1;
+    }
+
+    layout->font = font;
+    layout->max_width = max_width;
+
+    if (Relayout(layout, data, copy, len, 0, 0) == -1)
+    {
+        FreeText(copy, len);
+        SMF_DestroyHandle(&g_layouts, layout->base.handle);
+        return -1;
+    }
+
+    *out_layout = layout->base.handle;
+
+    return 0;
+}
+
+int SMF_UpdateLayout(SMF_Handle layout, const char *text, size_t edit_offset)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!text)
+    {
+        return SMF_InvalidArgError("text");
+    }
+
+    SMF_Layout *data = SMF_FindHandleObject(&g_layouts, layout);
+    if (!data)
+    {
+        return -1;
+    }
+
+    size_t len = strlen(text);
+    if (len >= UINT32_MAX)
+    {
+        return SMF_InvalidArgError("text");
+    }
+
+    if (edit_offset > len || edit_offset > data->text_len)
+    {
+        return SMF_InvalidArgError("edit_offset");
+    }
+
+    SMF_Font *font = SMF_GetFont(data->font);
+    if (!font)
+    {
+        return -1;
+    }
+
+    // the part of the text after the edit that did not change
+    size_t max_suffix = (len < data->text_len ? len : data->text_len) - edit_offset;
+    size_t suffix_len = 0;
+    while (suffix_len < max_suffix && text[len - suffix_len - 1] == data->text[data->text_len - suffix_len - 1])
+    {
+        suffix_len++;
+    }
+
+    // the edit may let the first word of its line move up, so wrapping restarts a line earlier
+    size_t first_line = FindLine(data->lines, data->lines_len, edit_offset);
+    if (first_line > 0)
+    {
+        first_line--;
+    }
+
+    char *copy = CopyText(text, len);
+    if (!copy)
+    {
+        return -1;
+    }
+
+    if (Relayout(data, font, copy, len, first_line, suffix_len) == -1)
+    {
+        FreeText(copy, len);
+        return -1;
+    }
+
+    return 0;
+}
+
+int SMF_GetLayoutSize(SMF_Handle layout, int *w, int *h)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    SMF_Layout *data = SMF_FindHandleObject(&g_layouts, layout);
+    if (!data)
+    {
+        return -1;
+    }
+
+    int height = SMF_GetFontHeight(data->font);
+    if (height == -1)
+    {
+        return -1;
+    }
+
+    if (w)
+    {
+        *w = data->width;
+    }
+
+    if (h)
+    {
+        *h = height * (int)data->lines_len;
+    }
+
+    return 0;
+}
+
+int SMF_RenderLayout(SMF_Handle layout, int x, int y)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    SMF_Layout *data = SMF_FindHandleObject(&g_layouts, layout);
+    if (!data)
+    {
+        return -1;
+    }
+
+    int height = SMF_GetFontHeight(data->font);
+    if (height == -1)
+    {
+        return -1;
+    }
+
+    int render_h = 0;
+    if (SMF_GetRenderSize(NULL, &render_h) == -1)
+    {
+        return -1;
+    }
+
+    // only the lines that overlap the render area are drawn
+    size_t first = 0;
+    if (y < 0 && height > 0)
+    {
+        first = (size_t)(-y / height);
+    }
+
+    for (size_t ix = first; ix < data->lines_len; ++ix)
+    {
+        int line_y = y + (int)ix * height;
+        if (line_y >= render_h)
+        {
+            break;
+        }
+
+        const SMF_LayoutLine *line = data->lines + ix;
+        if (SMF_RenderTextN(data->font, data->text + line->offset, line->len, x, line_y) == -1)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void SMF_DestroyLayout(SMF_Handle layout)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return;
+    }
+
+    SMF_DestroyHandle(&g_layouts, layout);
+}
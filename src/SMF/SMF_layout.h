@@ -0,0 +1,7 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+int SMF_InitLayouts(void);
+void SMF_CleanLayouts(void);
@@ -1,13 +1,166 @@
 // Copyright (c) 2024-present, Jason Hoyt
 // Distributed under the MIT License (http://opensource.org/licenses/MIT)
 
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_mem.h"
 
 #include "SMF_context.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define ATOMIC_ADD(Ptr, Value) _InterlockedExchangeAdd64((volatile int64_t *)(Ptr), (Value))
+#define ATOMIC_LOAD(Ptr) (*(volatile int64_t *)(Ptr))
+#define ATOMIC_STORE(Ptr, Value) (*(volatile int64_t *)(Ptr) = (Value))
+#else
+#define ATOMIC_ADD(Ptr, Value) __atomic_fetch_add((Ptr), (Value), __ATOMIC_RELAXED)
+#define ATOMIC_LOAD(Ptr) __atomic_load_n((Ptr), __ATOMIC_RELAXED)
+#define ATOMIC_STORE(Ptr, Value) __atomic_store_n((Ptr), (Value), __ATOMIC_RELAXED)
+#endif
+
+#define SMF_FRAME_ALIGN 16
+#define SMF_FRAME_MIN_BLOCK_SIZE (64 * 1024)
+
+#define ALIGN_SIZE(Size) (((Size) + (SMF_FRAME_ALIGN - 1)) & ~(size_t)(SMF_FRAME_ALIGN - 1))
+
+typedef struct SMF_FrameBlock
+{
+    struct SMF_FrameBlock *next;
+    size_t cap;
+    size_t used;
+} SMF_FrameBlock;
+
+#define SMF_FRAME_HEADER_SIZE ALIGN_SIZE(sizeof(SMF_FrameBlock))
+
+static void *DefaultAlloc(size_t size, void *user)
+{
+    return malloc(size);
+}
+
+static void *DefaultRealloc(void *ptr, size_t size, void *user)
+{
+    return realloc(ptr, size);
+}
+
+static void DefaultFree(void *ptr, void *user)
+{
+    free(ptr);
+}
+
+static SMF_AllocFunc g_alloc = DefaultAlloc;
+static SMF_ReallocFunc g_realloc = DefaultRealloc;
+static SMF_FreeFunc g_free = DefaultFree;
+static void *g_alloc_user = NULL;
+
+typedef struct SMF_MemoryCounters
+{
+    int64_t current;
+    int64_t peak;
+    int64_t allocs;
+    int64_t frees;
+} SMF_MemoryCounters;
+
+static SMF_MemoryCounters g_counters[SMF_MEMORY_SUBSYSTEM_COUNT];
+static int64_t g_handle_set_used = 0;
+
+// the blocks of the frame arena (the head is the block currently being allocated from)
+static SMF_FrameBlock *g_frame_blocks = NULL;
+
+static void *SDLMalloc(size_t size)
+{
+    return g_alloc(size, g_alloc_user);
+}
+
+static void *SDLCalloc(size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size)
+    {
+        return NULL;
+    }
+
+    void *ptr = g_alloc(count * size, g_alloc_user);
+    if (ptr)
+    {
+        memset(ptr, 0, count * size);
+    }
+
+    return ptr;
+}
+
+static void *SDLRealloc(void *ptr, size_t size)
+{
+    return g_realloc(ptr, size, g_alloc_user);
+}
+
+static void SDLFree(void *ptr)
+{
+    g_free(ptr, g_alloc_user);
+}
+
+int SMF_SetAllocator(SMF_AllocFunc alloc, SMF_ReallocFunc realloc_fn, SMF_FreeFunc free_fn, void *user)
+{
+    if (SMF_IsNotInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!alloc && !realloc_fn && !free_fn)
+    {
+        SDL_malloc_func sdl_malloc = NULL;
+        SDL_calloc_func sdl_calloc = NULL;
+        SDL_realloc_func sdl_realloc = NULL;
+        SDL_free_func sdl_free = NULL;
+        SDL_GetOriginalMemoryFunctions(&sdl_malloc, &sdl_calloc, &sdl_realloc, &sdl_free);
+        if (SDL_SetMemoryFunctions(sdl_malloc, sdl_calloc, sdl_realloc, sdl_free) == -1)
+        {
+            return SMF_SDLError();
+        }
+
+        g_alloc = DefaultAlloc;
+        g_realloc = DefaultRealloc;
+        g_free = DefaultFree;
+        g_alloc_user = NULL;
+
+        return 0;
+    }
+
+    if (!alloc)
+    {
+        return SMF_InvalidArgError("alloc");
+    }
+
+    if (!realloc_fn)
+    {
+        return SMF_InvalidArgError("realloc");
+    }
+
+    if (!free_fn)
+    {
+        return SMF_InvalidArgError("free");
+    }
+
+    g_alloc = alloc;
+    g_realloc = realloc_fn;
+    g_free = free_fn;
+    g_alloc_user = user;
+
+    if (SDL_SetMemoryFunctions(SDLMalloc, SDLCalloc, SDLRealloc, SDLFree) == -1)
+    {
+        return SMF_SDLError();
+    }
+
+    return 0;
+}
+
 void *SMF_Calloc(size_t count, size_t size)
 {
-    void *ptr = calloc(count, size);
+    void *ptr = SDLCalloc(count, size);
     if (!ptr)
     {
         SMF_SetError("out of memory");
@@ -17,10 +170,162 @@ void *SMF_Calloc(size_t count, size_t size)
     return ptr;
 }
 
+// same as SMF_Calloc without setting the error, so it can be used from threads other than the main one
+void *SMF_TryCalloc(size_t count, size_t size)
+{
+    return SDLCalloc(count, size);
+}
+
 void SMF_Free(void *ptr)
 {
     if (ptr)
     {
-        free(ptr);
+        g_free(ptr, g_alloc_user);
+    }
+}
+
+void SMF_TrackAlloc(SMF_MemorySubsystem subsystem, size_t size)
+{
+    SMF_MemoryCounters *counters = g_counters + subsystem;
+
+    // the peak is updated without a compare-and-swap, so concurrent allocations may under-report it slightly
+    int64_t current = ATOMIC_ADD(&counters->current, (int64_t)size) + (int64_t)size;
+    if (current > ATOMIC_LOAD(&counters->peak))
+    {
+        ATOMIC_STORE(&counters->peak, current);
+    }
+
+    ATOMIC_ADD(&counters->allocs, 1);
+}
+
+void SMF_TrackFree(SMF_MemorySubsystem subsystem, size_t size)
+{
+    SMF_MemoryCounters *counters = g_counters + subsystem;
+    ATOMIC_ADD(&counters->current, -(int64_t)size);
+    ATOMIC_ADD(&counters->frees, 1);
+}
+
+void SMF_TrackHandleSetUsage(int64_t size)
+{
+    ATOMIC_ADD(&g_handle_set_used, size);
+}
+
+int SMF_GetMemoryStats(SMF_MemoryStats *stats)
+{
+    if (!stats)
+    {
+        return SMF_InvalidArgError("stats");
+    }
+
+    for (int ix = 0; ix < SMF_MEMORY_SUBSYSTEM_COUNT; ++ix)
+    {
+        SMF_MemoryCounters *counters = g_counters + ix;
+        stats->subsystems[ix].current = (uint64_t)ATOMIC_LOAD(&counters->current);
+        stats->subsystems[ix].peak = (uint64_t)ATOMIC_LOAD(&counters->peak);
+        stats->subsystems[ix].allocs = (uint64_t)ATOMIC_LOAD(&counters->allocs);
+        stats->subsystems[ix].frees = (uint64_t)ATOMIC_LOAD(&counters->frees);
+    }
+
+    stats->handle_set_used = (uint64_t)ATOMIC_LOAD(&g_handle_set_used);
+
+    return 0;
+}
+
+static SMF_FrameBlock *CreateFrameBlock(size_t cap)
+{
+    SMF_FrameBlock *block = g_alloc(SMF_FRAME_HEADER_SIZE + cap, g_alloc_user);
+    if (!block)
+    {
+        return NULL;
+    }
+
+    block->next = NULL;
+    block->cap = cap;
+    block->used = 0;
+
+    SMF_TrackAlloc(SMF_MEMORY_FRAME_ARENA, SMF_FRAME_HEADER_SIZE + cap);
+
+    return block;
+}
+
+static void DestroyFrameBlock(SMF_FrameBlock *block)
+{
+    SMF_TrackFree(SMF_MEMORY_FRAME_ARENA, SMF_FRAME_HEADER_SIZE + block->cap);
+    g_free(block, g_alloc_user);
+}
+
+void *SMF_FrameAlloc(size_t size)
+{
+    size = ALIGN_SIZE(size);
+
+    SMF_FrameBlock *block = g_frame_blocks;
+    if (!block || block->cap - block->used < size)
+    {
+        size_t cap = SMF_FRAME_MIN_BLOCK_SIZE;
+        if (block && block->cap * 2 > cap)
+        {
+            cap = block->cap * 2;
+        }
+
+        if (size > cap)
+        {
+            cap = size;
+        }
+
+        block = CreateFrameBlock(cap);
+        if (!block)
+        {
+            SMF_SetError("out of memory");
+            return NULL;
+        }
+
+        block->next = g_frame_blocks;
+        g_frame_blocks = block;
+    }
+
+    void *ptr = (char *)block + SMF_FRAME_HEADER_SIZE + block->used;
+    block->used += size;
+
+    return ptr;
+}
+
+void SMF_ResetFrameArena(void)
+{
+    if (!g_frame_blocks)
+    {
+        return;
     }
+
+    if (!g_frame_blocks->next)
+    {
+        g_frame_blocks->used = 0;
+        return;
+    }
+
+    // the frame overflowed the first block, so coalesce everything into a single block large enough to hold the
+    // whole frame (this way the arena stops allocating once the application reaches a steady state)
+    size_t total = 0;
+    SMF_FrameBlock *block = g_frame_blocks;
+    while (block)
+    {
+        SMF_FrameBlock *next = block->next;
+        total += block->cap;
+        DestroyFrameBlock(block);
+        block = next;
+    }
+
+    g_frame_blocks = CreateFrameBlock(total);
+}
+
+void SMF_CleanFrameArena(void)
+{
+    SMF_FrameBlock *block = g_frame_blocks;
+    while (block)
+    {
+        SMF_FrameBlock *next = block->next;
+        DestroyFrameBlock(block);
+        block = next;
+    }
+
+    g_frame_blocks = NULL;
 }
@@ -3,5 +3,17 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 void *SMF_Calloc(size_t count, size_t size);
+void *SMF_TryCalloc(size_t count, size_t size);
 void SMF_Free(void *ptr);
+
+void SMF_TrackAlloc(SMF_MemorySubsystem subsystem, size_t size);
+void SMF_TrackFree(SMF_MemorySubsystem subsystem, size_t size);
+void SMF_TrackHandleSetUsage(int64_t size);
+
+void *SMF_FrameAlloc(size_t size);
+void SMF_ResetFrameArena(void);
+void SMF_CleanFrameArena(void);
@@ -0,0 +1,300 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <stdint.h>
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_nine_slice.h"
+
+#include "SMF_context.h"
+#include "SMF_handle_set.h"
+#include "SMF_image.h"
+#include "SMF_render.h"
+#include "SMF_window.h"
+
+// the number of panel sizes of a nine-slice that are remembered (and expanded once they are drawn again)
+#define SMF_NINE_SLICE_CACHE_SIZE 4
+
+// a panel size that was drawn, with its fully expanded image once the size has been drawn in more than one frame
+typedef struct SMF_PanelCacheEntry
+{
+    int w, h;
+    SMF_Handle image;
+    uint64_t frame;
+} SMF_PanelCacheEntry;
+
+typedef struct SMF_NineSlice
+{
+    SMF_HandleObject base;
+    SMF_Handle image;
+    SMF_Insets insets;
+    int cache_len;
+    SMF_PanelCacheEntry cache[SMF_NINE_SLICE_CACHE_SIZE];
+} SMF_NineSlice;
+
+static SMF_HandleSet g_nine_slices;
+
+static void DestroyNineSlice(void *data)
+{
+    // the textures of the expanded panels stay alive until the commands of the current frame (which may still draw
+    // or expand them) have been executed
+    SMF_NineSlice *nine_slice = (SMF_NineSlice *)data;
+    for (int ix = 0; ix < nine_slice->cache_len; ++ix)
+    {
+        if (nine_slice->cache[ix].image != SMF_INVALID_HANDLE)
+        {
+            SMF_DestroyImage(nine_slice->cache[ix].image);
+        }
+    }
+}
+
+int SMF_InitNineSlices(void)
+{
+    return SMF_InitHandleSet(&g_nine_slices, SMF_HANDLE_TYPE_NINE_SLICE, sizeof(SMF_NineSlice), DestroyNineSlice);
+}
+
+void SMF_CleanNineSlices(void)
+{
+    SMF_CleanHandleSet(&g_nine_slices);
+}
+
+void SMF_InvalidateNineSlices(void)
+{
+    // the expanded panels lost their pixels, so they are dropped and expanded again when their size is drawn next
+    for (uint64_t ix = 0; ix < g_nine_slices.data_len; ++ix)
+    {
+        SMF_NineSlice *nine_slice = (SMF_NineSlice *)(g_nine_slices.data + (ix * g_nine_slices.data_size));
+        if (nine_slice->base.handle == 0)
+        {
+            continue;
+        }
+
+        for (int entry = 0; entry < nine_slice->cache_len; ++entry)
+        {
+            if (nine_slice->cache[entry].image != SMF_INVALID_HANDLE)
+            {
+                SMF_DestroyImage(nine_slice->cache[entry].image);
+                nine_slice->cache[entry].image = SMF_INVALID_HANDLE;
+            }
+        }
+    }
+}
+
+SMF_Handle SMF_CreateNineSlice(SMF_Handle image, const SMF_Insets *insets)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    if (!insets)
+    {
+        SMF_InvalidArgError("insets");
+        return SMF_INVALID_HANDLE;
+    }
+
+    int w = 0;
+    int h = 0;
+    if (SMF_GetImageSize(image, &w, &h) == -1)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    if (insets->left < 0 || insets->top < 0 || insets->right < 0 || insets->bottom < 0 ||
+        insets->left + insets->right > w || insets->top + insets->bottom > h)
+    {
+        SMF_InvalidArgError("insets");
+        return SMF_INVALID_HANDLE;
+    }
+
+    SMF_NineSlice *nine_slice = SMF_CreateHandle(&g_nine_slices);
+    if (!nine_slice)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    nine_slice->image = image;
+    nine_slice->insets = *insets;
+    nine_slice->cache_len = 0;
+
+    return nine_slice->base.handle;
+}
+
+// the edges of the three slices along one axis, in the image and in the panel (the borders shrink proportionally
+// when the panel is smaller than both of them)
+static void SliceAxis(int size, int lo, int hi, int panel_size, int *src, int *dst)
+{
+    src[0] = 0;
+    src[1] = lo;
+    src[2] = size - hi;
+    src[3] = size;
+
+    if (lo + hi > panel_size)
+    {
+        lo = (int)((int64_t)panel_size * lo / (lo + hi));
+        hi = panel_size - lo;
+    }
+
+    dst[0] = 0;
+    dst[1] = lo;
+    dst[2] = panel_size - hi;
+    dst[3] = panel_size;
+}
+
+static int SlicePanel(const SMF_NineSlice *nine_slice, int image_w, int image_h, int w, int h, SDL_Rect *src,
+                      SDL_Rect *dst)
+{
+    int src_x[4], dst_x[4], src_y[4], dst_y[4];
+    SliceAxis(image_w, nine_slice->insets.left, nine_slice->insets.right, w, src_x, dst_x);
+    SliceAxis(image_h, nine_slice->insets.top, nine_slice->insets.bottom, h, src_y, dst_y);
+
+    int count = 0;
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 3; ++col)
+        {
+            SDL_Rect s = {src_x[col], src_y[row], src_x[col + 1] - src_x[col], src_y[row + 1] - src_y[row]};
+            SDL_Rect d = {dst_x[col], dst_y[row], dst_x[col + 1] - dst_x[col], dst_y[row + 1] - dst_y[row]};
+            if (s.w > 0 && s.h > 0 && d.w > 0 && d.h > 0)
+            {
+                src[count] = s;
+                dst[count] = d;
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+// finds the cache entry of a panel size, or makes room for it (NULL when every entry is in use this frame)
+static SMF_PanelCacheEntry *GetPanelCacheEntry(SMF_NineSlice *nine_slice, int w, int h, int *is_new)
+{
+    *is_new = 0;
+
+    SMF_PanelCacheEntry *oldest = NULL;
+    for (int ix = 0; ix < nine_slice->cache_len; ++ix)
+    {
+        SMF_PanelCacheEntry *entry = nine_slice->cache + ix;
+        if (entry->w == w && entry->h == h)
+        {
+            return entry;
+        }
+
+        if (!oldest || entry->frame < oldest->frame)
+        {
+            oldest = entry;
+        }
+    }
+
+    *is_new = 1;
+
+    if (nine_slice->cache_len < SMF_NINE_SLICE_CACHE_SIZE)
+    {
+        oldest = nine_slice->cache + nine_slice->cache_len;
+        nine_slice->cache_len++;
+    }
+    else if (oldest->frame == SMF_GetFrameNumber())
+    {
+        // every size is in use this frame, so replacing one would only make them evict each other every frame
+        return NULL;
+    }
+    else if (oldest->image != SMF_INVALID_HANDLE)
+    {
+        SMF_DestroyImage(oldest->image);
+    }
+
+    oldest->w = w;
+    oldest->h = h;
+    oldest->image = SMF_INVALID_HANDLE;
+
+    return oldest;
+}
+
+int SMF_RenderNineSlice(SMF_Handle nine_slice, const SMF_Rect *rect)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    if (!rect || rect->w < 0 || rect->h < 0)
+    {
+        return SMF_InvalidArgError("rect");
+    }
+
+    SMF_NineSlice *data = SMF_FindHandleObject(&g_nine_slices, nine_slice);
+    if (!data)
+    {
+        return -1;
+    }
+
+    if (rect->w == 0 || rect->h == 0)
+    {
+        return 0;
+    }
+
+    uint64_t frame = SMF_GetFrameNumber();
+
+    int is_new = 0;
+    SMF_PanelCacheEntry *entry = GetPanelCacheEntry(data, rect->w, rect->h, &is_new);
+    if (entry && entry->image != SMF_INVALID_HANDLE)
+    {
+        entry->frame = frame;
+        return SMF_PushImageCommand(entry->image, rect->x, rect->y);
+    }
+
+    int image_w = 0;
+    int image_h = 0;
+    SDL_Texture *texture = SMF_GetImageTexture(data->image, &image_w, &image_h);
+    if (!texture)
+    {
+        return -1;
+    }
+
+    // a size is only expanded once it shows up again in a later frame, so panels that animate their size never
+    // allocate anything
+    SDL_Texture *cache = NULL;
+    if (entry && !is_new && entry->frame != frame && SDL_RenderTargetSupported(SMF_GetRenderer()))
+    {
+        SMF_Handle image = SMF_CreateRenderTarget(rect->w, rect->h);
+        if (image == SMF_INVALID_HANDLE)
+        {
+            return -1;
+        }
+
+        entry->image = image;
+        cache = SMF_GetRenderTargetTexture(image);
+    }
+
+    if (entry)
+    {
+        entry->frame = frame;
+    }
+
+    SDL_Rect src[9];
+    SDL_Rect dst[9];
+    int count = SlicePanel(data, image_w, image_h, rect->w, rect->h, src, dst);
+
+    SDL_Rect panel = {rect->x, rect->y, rect->w, rect->h};
+
+    return SMF_PushNineSliceCommand(texture, src, dst, count, &panel, cache);
+}
+
+void SMF_DestroyNineSlice(SMF_Handle nine_slice)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return;
+    }
+
+    SMF_DestroyHandle(&g_nine_slices, nine_slice);
+}
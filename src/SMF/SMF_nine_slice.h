@@ -0,0 +1,8 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+int SMF_InitNineSlices(void);
+void SMF_CleanNineSlices(void);
+void SMF_InvalidateNineSlices(void);
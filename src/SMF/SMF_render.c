@@ -0,0 +1,992 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_render.h"
+
+#include "SMF_capture.h"
+#include "SMF_context.h"
+#include "SMF_font.h"
+#include "SMF_image.h"
+#include "SMF_mem.h"
+#include "SMF_replay.h"
+#include "SMF_shared_frame.h"
+#include "SMF_text_grid.h"
+#include "SMF_window.h"
+
+#define SMF_RENDER_COMMAND_BLOCK_SIZE 256
+
+typedef enum SMF_RenderCommandType
+{
+    SMF_RENDER_COMMAND_IMAGE = 1,
+    SMF_RENDER_COMMAND_FILL_RECT,
+    SMF_RENDER_COMMAND_CLIP,
+    SMF_RENDER_COMMAND_UNCLIP,
+    SMF_RENDER_COMMAND_TEXT_GRID,
+    SMF_RENDER_COMMAND_TARGET,
+    SMF_RENDER_COMMAND_CLEAR,
+    SMF_RENDER_COMMAND_FILL_RECTS,
+    SMF_RENDER_COMMAND_RECTS,
+    SMF_RENDER_COMMAND_LINES,
+    SMF_RENDER_COMMAND_IMAGE_EX,
+    SMF_RENDER_COMMAND_NINE_SLICE
+} SMF_RenderCommandType;
+
+// the rotation and flipping of an image command (in the frame arena)
+typedef struct SMF_ImageTransform
+{
+    double angle;
+    SDL_Point pivot;
+    int has_pivot;
+    SDL_RendererFlip flip;
+} SMF_ImageTransform;
+
+// the pieces of a nine-slice panel relative to its origin, and the target to expand it into first (in the frame
+// arena)
+typedef struct SMF_PanelPieces
+{
+    SDL_Texture *cache;
+    SDL_Rect src[9];
+    SDL_Rect dst[9];
+} SMF_PanelPieces;
+
+typedef struct SMF_RenderCommand
+{
+    SMF_RenderCommandType type;
+    SMF_Color color;
+    SDL_Texture *texture;
+    SMF_Handle handle;
+    SDL_Rect rect;
+    SDL_BlendMode blend;
+    SDL_ScaleMode scale;
+    // the rectangles or points of a batched primitive command, the transform of an image or the pieces of a panel
+    // (in the frame arena)
+    const void *data;
+    int count;
+} SMF_RenderCommand;
+
+typedef struct SMF_RenderCommandBlock
+{
+    struct SMF_RenderCommandBlock *next;
+    int count;
+    SMF_RenderCommand commands[SMF_RENDER_COMMAND_BLOCK_SIZE];
+} SMF_RenderCommandBlock;
+
+static SMF_Color g_render_color = SMF_RGB(255, 255, 255);
+static SMF_BlendMode g_render_blend_mode = SMF_BLEND_MODE_ALPHA;
+static SDL_BlendMode g_blend_mode = SDL_BLENDMODE_BLEND;
+static uint64_t g_frame_number = 0;
+
+// the clipping and target state the commands recorded so far leave behind, which batched primitives are culled
+// against before they are copied into the command list
+static int g_is_clipped = 0;
+static SDL_Rect g_clip_rect;
+static SDL_Texture *g_target = NULL;
+
+// the command list lives in the frame arena and is discarded at the end of each frame
+static SMF_RenderCommandBlock *g_first_block = NULL;
+static SMF_RenderCommandBlock *g_last_block = NULL;
+
+static void ResetRenderState(void)
+{
+    g_render_color = SMF_RGB(255, 255, 255);
+    g_render_blend_mode = SMF_BLEND_MODE_ALPHA;
+    g_blend_mode = SDL_BLENDMODE_BLEND;
+    g_is_clipped = 0;
+    g_target = NULL;
+    g_first_block = NULL;
+    g_last_block = NULL;
+}
+
+void SMF_CleanRender(void)
+{
+    ResetRenderState();
+}
+
+uint64_t SMF_GetFrameNumber(void)
+{
+    return g_frame_number;
+}
+
+static SMF_RenderCommand *PushCommand(SMF_RenderCommandType type)
+{
+    if (!g_last_block || g_last_block->count == SMF_RENDER_COMMAND_BLOCK_SIZE)
+    {
+        SMF_RenderCommandBlock *block = SMF_FrameAlloc(sizeof(SMF_RenderCommandBlock));
+        if (!block)
+        {
+            return NULL;
+        }
+
+        block->next = NULL;
+        block->count = 0;
+
+        if (g_last_block)
+        {
+            g_last_block->next = block;
+        }
+        else
+        {
+            g_first_block = block;
+        }
+
+        g_last_block = block;
+    }
+
+    SMF_RenderCommand *cmd = g_last_block->commands + g_last_block->count;
+    g_last_block->count++;
+
+    cmd->type = type;
+    cmd->color = g_render_color;
+    cmd->texture = NULL;
+    cmd->blend = g_blend_mode;
+    cmd->scale = SDL_ScaleModeNearest;
+
+    return cmd;
+}
+
+// blending an opaque image at full opacity gives back the image, so it is copied instead
+static SDL_BlendMode GetImageBlendMode(SMF_Handle image)
+{
+    if (g_render_blend_mode == SMF_BLEND_MODE_ALPHA && SMF_ALPHA(g_render_color) == 255 && SMF_IsImageOpaque(image))
+    {
+        return SDL_BLENDMODE_NONE;
+    }
+
+    return g_blend_mode;
+}
+
+// a texture cannot be read while it is being rendered to
+static int IsDrawingIntoItself(SDL_Texture *texture)
+{
+    if (g_target && texture == g_target)
+    {
+        SMF_SetError("a render target cannot be drawn into itself");
+        return 1;
+    }
+
+    return 0;
+}
+
+int SMF_PushImageCommand(SMF_Handle image, int x, int y)
+{
+    int w = 0;
+    int h = 0;
+    SDL_Texture *texture = SMF_GetImageTexture(image, &w, &h);
+    if (!texture || IsDrawingIntoItself(texture))
+    {
+        return -1;
+    }
+
+    SMF_RenderCommand *cmd = PushCommand(SMF_RENDER_COMMAND_IMAGE);
+    if (!cmd)
+    {
+        return -1;
+    }
+
+    cmd->texture = texture;
+    cmd->rect.x = x;
+    cmd->rect.y = y;
+    cmd->rect.w = w;
+    cmd->rect.h = h;
+    cmd->blend = GetImageBlendMode(image);
+
+    return 0;
+}
+
+int SMF_PushTextGridCommand(SMF_Handle grid, int x, int y)
+{
+    SMF_RenderCommand *cmd = PushCommand(SMF_RENDER_COMMAND_TEXT_GRID);
+    if (!cmd)
+    {
+        return -1;
+    }
+
+    cmd->handle = grid;
+    cmd->rect.x = x;
+    cmd->rect.y = y;
+
+    return 0;
+}
+
+int SMF_PushNineSliceCommand(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, int count,
+                             const SDL_Rect *panel, SDL_Texture *cache)
+{
+    if (IsDrawingIntoItself(texture))
+    {
+        return -1;
+    }
+
+    SMF_PanelPieces *pieces = SMF_FrameAlloc(sizeof(SMF_PanelPieces));
+    if (!pieces)
+    {
+        return -1;
+    }
+
+    pieces->cache = cache;
+    memcpy(pieces->src, src, sizeof(SDL_Rect) * (size_t)count);
+    memcpy(pieces->dst, dst, sizeof(SDL_Rect) * (size_t)count);
+
+    SMF_RenderCommand *cmd = PushCommand(SMF_RENDER_COMMAND_NINE_SLICE);
+    if (!cmd)
+    {
+        return -1;
+    }
+
+    cmd->texture = texture;
+    cmd->rect = *panel;
+    cmd->data = pieces;
+    cmd->count = count;
+
+    return 0;
+}
+
+// copies the pieces of a panel into its cache target (untinted, the tint is applied when the target is drawn)
+static void ExpandPanel(SDL_Renderer *renderer, SDL_Texture *texture, const SMF_PanelPieces *pieces, int count)
+{
+    SDL_Texture *prev_target = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, pieces->cache);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+
+    SDL_SetTextureColorMod(texture, 255, 255, 255);
+    SDL_SetTextureAlphaMod(texture, 255);
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+    SDL_SetTextureScaleMode(texture, SDL_ScaleModeNearest);
+    for (int ix = 0; ix < count; ++ix)
+    {
+        SDL_RenderCopy(renderer, texture, pieces->src + ix, pieces->dst + ix);
+    }
+
+    SDL_SetRenderTarget(renderer, prev_target);
+}
+
+static void ExecuteCommands(SDL_Renderer *renderer)
+{
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    // switching targets drops the clip rectangle of a texture target, so it is kept here to restore it after a text
+    // grid (which renders through targets of its own)
+    const SDL_Rect *clip = NULL;
+
+    // set when the target of the commands that follow was destroyed during the frame, these commands are dropped
+    int is_discarding = 0;
+
+    for (SMF_RenderCommandBlock *block = g_first_block; block; block = block->next)
+    {
+        for (int ix = 0; ix < block->count; ++ix)
+        {
+            const SMF_RenderCommand *cmd = block->commands + ix;
+            if (is_discarding && cmd->type != SMF_RENDER_COMMAND_TARGET)
+            {
+                continue;
+            }
+
+            switch (cmd->type)
+            {
+            case SMF_RENDER_COMMAND_IMAGE:
+                SDL_SetTextureColorMod(
+                    cmd->texture, SMF_RED(cmd->color), SMF_GREEN(cmd->color), SMF_BLUE(cmd->color));
+                SDL_SetTextureAlphaMod(cmd->texture, SMF_ALPHA(cmd->color));
+                SDL_SetTextureBlendMode(cmd->texture, cmd->blend);
+                SDL_SetTextureScaleMode(cmd->texture, cmd->scale);
+                SDL_RenderCopy(renderer, cmd->texture, NULL, &cmd->rect);
+                break;
+            case SMF_RENDER_COMMAND_IMAGE_EX: {
+                const SMF_ImageTransform *transform = cmd->data;
+                SDL_SetTextureColorMod(
+                    cmd->texture, SMF_RED(cmd->color), SMF_GREEN(cmd->color), SMF_BLUE(cmd->color));
+                SDL_SetTextureAlphaMod(cmd->texture, SMF_ALPHA(cmd->color));
+                SDL_SetTextureBlendMode(cmd->texture, cmd->blend);
+                SDL_SetTextureScaleMode(cmd->texture, cmd->scale);
+                SDL_RenderCopyEx(renderer,
+                                 cmd->texture,
+                                 NULL,
+                                 &cmd->rect,
+                                 transform->angle,
+                                 transform->has_pivot ? &transform->pivot : NULL,
+                                 transform->flip);
+                break;
+            }
+            case SMF_RENDER_COMMAND_NINE_SLICE: {
+                const SMF_PanelPieces *pieces = cmd->data;
+                SDL_Texture *texture = cmd->texture;
+                if (pieces->cache)
+                {
+                    ExpandPanel(renderer, texture, pieces, cmd->count);
+                    SDL_RenderSetClipRect(renderer, clip);
+                    texture = pieces->cache;
+                }
+
+                SDL_SetTextureColorMod(texture, SMF_RED(cmd->color), SMF_GREEN(cmd->color), SMF_BLUE(cmd->color));
+                SDL_SetTextureAlphaMod(texture, SMF_ALPHA(cmd->color));
+                SDL_SetTextureBlendMode(texture, cmd->blend);
+                SDL_SetTextureScaleMode(texture, cmd->scale);
+                if (pieces->cache)
+                {
+                    SDL_RenderCopy(renderer, texture, NULL, &cmd->rect);
+                    break;
+                }
+
+                for (int piece = 0; piece < cmd->count; ++piece)
+                {
+                    SDL_Rect dst = pieces->dst[piece];
+                    dst.x += cmd->rect.x;
+                    dst.y += cmd->rect.y;
+                    SDL_RenderCopy(renderer, texture, pieces->src + piece, &dst);
+                }
+                break;
+            }
+            case SMF_RENDER_COMMAND_FILL_RECT:
+                SDL_SetRenderDrawColor(renderer,
+                                       SMF_RED(cmd->color),
+                                       SMF_GREEN(cmd->color),
+                                       SMF_BLUE(cmd->color),
+                                       SMF_ALPHA(cmd->color));
+                SDL_SetRenderDrawBlendMode(renderer, cmd->blend);
+                SDL_RenderFillRect(renderer, &cmd->rect);
+                break;
+            case SMF_RENDER_COMMAND_CLIP:
+                SDL_RenderSetClipRect(renderer, &cmd->rect);
+                clip = &cmd->rect;
+                break;
+            case SMF_RENDER_COMMAND_UNCLIP:
+                SDL_RenderSetClipRect(renderer, NULL);
+                clip = NULL;
+                break;
+            case SMF_RENDER_COMMAND_TEXT_GRID:
+                SMF_DrawTextGrid(renderer, cmd->handle, cmd->rect.x, cmd->rect.y);
+                SDL_RenderSetClipRect(renderer, clip);
+                break;
+            case SMF_RENDER_COMMAND_TARGET: {
+                // the target is looked up again since it may have been destroyed after it was selected
+                SDL_Texture *target = NULL;
+                if (cmd->handle != SMF_INVALID_HANDLE)
+                {
+                    target = SMF_GetRenderTargetTexture(cmd->handle);
+                }
+
+                is_discarding = cmd->handle != SMF_INVALID_HANDLE && !target;
+                SDL_SetRenderTarget(renderer, target);
+                SDL_RenderSetClipRect(renderer, NULL);
+                clip = NULL;
+                break;
+            }
+            case SMF_RENDER_COMMAND_FILL_RECTS:
+            case SMF_RENDER_COMMAND_RECTS:
+            case SMF_RENDER_COMMAND_LINES:
+                SDL_SetRenderDrawColor(renderer,
+                                       SMF_RED(cmd->color),
+                                       SMF_GREEN(cmd->color),
+                                       SMF_BLUE(cmd->color),
+                                       SMF_ALPHA(cmd->color));
+                SDL_SetRenderDrawBlendMode(renderer, cmd->blend);
+                if (cmd->type == SMF_RENDER_COMMAND_FILL_RECTS)
+                {
+                    SDL_RenderFillRects(renderer, cmd->data, cmd->count);
+                }
+                else if (cmd->type == SMF_RENDER_COMMAND_RECTS)
+                {
+                    SDL_RenderDrawRects(renderer, cmd->data, cmd->count);
+                }
+                else
+                {
+                    SDL_RenderDrawLines(renderer, cmd->data, cmd->count);
+                }
+                break;
+            case SMF_RENDER_COMMAND_CLEAR:
+                SDL_SetRenderDrawColor(renderer,
+                                       SMF_RED(cmd->color),
+                                       SMF_GREEN(cmd->color),
+                                       SMF_BLUE(cmd->color),
+                                       SMF_ALPHA(cmd->color));
+                SDL_RenderClear(renderer);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    SDL_SetRenderTarget(renderer, NULL);
+    SDL_RenderSetClipRect(renderer, NULL);
+}
+
+int SMF_GetRenderSize(int *w, int *h)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    int out_w = 0;
+    int out_h = 0;
+    if (SDL_GetRendererOutputSize(SMF_GetRenderer(), &out_w, &out_h) == -1)
+    {
+        return SMF_SDLError();
+    }
+
+    int scale = SMF_GetWindowScale();
+
+    if (w)
+    {
+        *w = out_w / scale;
+    }
+
+    if (h)
+    {
+        *h = out_h / scale;
+    }
+
+    return 0;
+}
+
+int SMF_RenderPresent(void)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    SDL_Renderer *renderer = SMF_GetRenderer();
+
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+
+    ExecuteCommands(renderer);
+
+    // images destroyed during the frame kept their textures until the commands that use them were executed
+    SMF_DestroyPendingTextures();
+
+    // the back buffer has to be read before presenting, its contents are undefined afterwards
+    SMF_CaptureFrame(renderer);
+    SMF_WriteSharedFrame(renderer);
+
+    SDL_RenderPresent(renderer);
+
+    ResetRenderState();
+    SMF_ResetFrameArena();
+    g_frame_number++;
+
+    SMF_PublishPrewarmedGlyphs();
+    SMF_OnFramePresented();
+
+    return 0;
+}
+
+int SMF_SetRenderColor(SMF_Color color)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    g_render_color = color;
+    return 0;
+}
+
+static SDL_BlendMode GetSDLBlendMode(SMF_BlendMode mode)
+{
+    switch (mode)
+    {
+    case SMF_BLEND_MODE_NONE:
+        return SDL_BLENDMODE_NONE;
+    case SMF_BLEND_MODE_ALPHA:
+        return SDL_BLENDMODE_BLEND;
+    case SMF_BLEND_MODE_PREMULTIPLIED:
+        return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE,
+                                          SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                                          SDL_BLENDOPERATION_ADD,
+                                          SDL_BLENDFACTOR_ONE,
+                                          SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                                          SDL_BLENDOPERATION_ADD);
+    case SMF_BLEND_MODE_ADD:
+        return SDL_BLENDMODE_ADD;
+    case SMF_BLEND_MODE_MULTIPLY:
+        return SDL_BLENDMODE_MUL;
+    default:
+        return SDL_BLENDMODE_INVALID;
+    }
+}
+
+int SMF_SetRenderBlendMode(SMF_BlendMode mode)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    SDL_BlendMode blend = GetSDLBlendMode(mode);
+    if (blend == SDL_BLENDMODE_INVALID)
+    {
+        return SMF_InvalidArgError("mode");
+    }
+
+    // custom blend modes are up to the renderer (the software renderer has none), so they are rejected here rather
+    // than silently falling back when the commands are executed
+    SDL_Renderer *renderer = SMF_GetRenderer();
+    if (renderer && SDL_SetRenderDrawBlendMode(renderer, blend) == -1)
+    {
+        return SMF_SetError("blend mode is not supported by the renderer");
+    }
+
+    g_render_blend_mode = mode;
+    g_blend_mode = blend;
+
+    return 0;
+}
+
+int SMF_RenderImage(SMF_Handle image, int x, int y)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    return SMF_PushImageCommand(image, x, y);
+}
+
+int SMF_RenderImageEx(SMF_Handle image, const SMF_Rect *dst_rect, double angle, const SMF_Point *pivot, SMF_Flip flip)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    if (!dst_rect || dst_rect->w < 0 || dst_rect->h < 0)
+    {
+        return SMF_InvalidArgError("dst_rect");
+    }
+
+    if (flip & ~(SMF_FLIP_HORIZONTAL | SMF_FLIP_VERTICAL))
+    {
+        return SMF_InvalidArgError("flip");
+    }
+
+    int w = 0;
+    int h = 0;
+    SDL_Texture *texture = SMF_GetImageTexture(image, &w, &h);
+    if (!texture || IsDrawingIntoItself(texture))
+    {
+        return -1;
+    }
+
+    // without rotation or flipping this is a regular (scaled) image command
+    int is_transformed = angle != 0.0 || flip != SMF_FLIP_NONE;
+
+    SMF_ImageTransform *transform = NULL;
+    if (is_transformed)
+    {
+        transform = SMF_FrameAlloc(sizeof(SMF_ImageTransform));
+        if (!transform)
+        {
+            return -1;
+        }
+
+        transform->angle = angle;
+        transform->has_pivot = pivot != NULL;
+        transform->pivot.x = pivot ? pivot->x : 0;
+        transform->pivot.y = pivot ? pivot->y : 0;
+        transform->flip = (SDL_RendererFlip)flip;
+    }
+
+    SMF_RenderCommand *cmd = PushCommand(is_transformed ? SMF_RENDER_COMMAND_IMAGE_EX : SMF_RENDER_COMMAND_IMAGE);
+    if (!cmd)
+    {
+        return -1;
+    }
+
+    cmd->texture = texture;
+    cmd->rect.x = dst_rect->x;
+    cmd->rect.y = dst_rect->y;
+    cmd->rect.w = dst_rect->w;
+    cmd->rect.h = dst_rect->h;
+    cmd->data = transform;
+
+    // axis-aligned integer scales map every destination pixel onto a single source pixel, anything else is filtered
+    int is_integer_scale = w > 0 && h > 0 && dst_rect->w % w == 0 && dst_rect->h % h == 0;
+    if (angle != 0.0 || !is_integer_scale)
+    {
+        cmd->scale = SDL_ScaleModeLinear;
+    }
+
+    // a rotated image leaves parts of its destination uncovered, which must not be overwritten by a copy
+    if (angle == 0.0)
+    {
+        cmd->blend = GetImageBlendMode(image);
+    }
+
+    return 0;
+}
+
+int SMF_RenderFillRect(int x, int y, int w, int h)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (w < 0)
+    {
+        return SMF_InvalidArgError("w");
+    }
+
+    if (h < 0)
+    {
+        return SMF_InvalidArgError("h");
+    }
+
+    SMF_RenderCommand *cmd = PushCommand(SMF_RENDER_COMMAND_FILL_RECT);
+    if (!cmd)
+    {
+        return -1;
+    }
+
+    cmd->rect.x = x;
+    cmd->rect.y = y;
+    cmd->rect.w = w;
+    cmd->rect.h = h;
+
+    return 0;
+}
+
+int SMF_SetRenderClipRect(int x, int y, int w, int h)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (w < 0)
+    {
+        return SMF_InvalidArgError("w");
+    }
+
+    if (h < 0)
+    {
+        return SMF_InvalidArgError("h");
+    }
+
+    SMF_RenderCommand *cmd = PushCommand(SMF_RENDER_COMMAND_CLIP);
+    if (!cmd)
+    {
+        return -1;
+    }
+
+    cmd->rect.x = x;
+    cmd->rect.y = y;
+    cmd->rect.w = w;
+    cmd->rect.h = h;
+
+    g_is_clipped = 1;
+    g_clip_rect = cmd->rect;
+
+    return 0;
+}
+
+int SMF_SetRenderTarget(SMF_Handle image)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    SDL_Texture *texture = NULL;
+    if (image != SMF_INVALID_HANDLE)
+    {
+        texture = SMF_GetRenderTargetTexture(image);
+        if (!texture)
+        {
+            return -1;
+        }
+    }
+
+    SMF_RenderCommand *cmd = PushCommand(SMF_RENDER_COMMAND_TARGET);
+    if (!cmd)
+    {
+        return -1;
+    }
+
+    cmd->handle = image;
+
+    g_is_clipped = 0;
+    g_target = texture;
+
+    return 0;
+}
+
+int SMF_RenderClear(void)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!PushCommand(SMF_RENDER_COMMAND_CLEAR))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+int SMF_ClearRenderClipRect(void)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!PushCommand(SMF_RENDER_COMMAND_UNCLIP))
+    {
+        return -1;
+    }
+
+    g_is_clipped = 0;
+
+    return 0;
+}
+
+// the area primitives can show up in: the clipping rectangle if there is one, otherwise the whole target
+static int GetCullRect(SDL_Rect *rect)
+{
+    if (g_is_clipped)
+    {
+        *rect = g_clip_rect;
+        return 0;
+    }
+
+    rect->x = 0;
+    rect->y = 0;
+
+    if (g_target)
+    {
+        if (SDL_QueryTexture(g_target, NULL, NULL, &rect->w, &rect->h) == -1)
+        {
+            return SMF_SDLError();
+        }
+
+        return 0;
+    }
+
+    return SMF_GetRenderSize(&rect->w, &rect->h);
+}
+
+static int ValidateBatchArgs(int count, const void *data, const char *arg)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    if (count < 0)
+    {
+        return SMF_InvalidArgError("count");
+    }
+
+    if (count > 0 && !data)
+    {
+        return SMF_InvalidArgError(arg);
+    }
+
+    return 0;
+}
+
+static int PushRectsCommand(SMF_RenderCommandType type, int count, const SMF_Rect *rects)
+{
+    if (ValidateBatchArgs(count, rects, "rects") == -1)
+    {
+        return -1;
+    }
+
+    // the whole batch is checked before any frame memory is reserved for it
+    for (int ix = 0; ix < count; ++ix)
+    {
+        if (rects[ix].w < 0 || rects[ix].h < 0)
+        {
+            return SMF_InvalidArgError("rects");
+        }
+    }
+
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    SDL_Rect cull;
+    if (GetCullRect(&cull) == -1)
+    {
+        return -1;
+    }
+
+    SDL_Rect *out = SMF_FrameAlloc(sizeof(SDL_Rect) * (size_t)count);
+    if (!out)
+    {
+        return -1;
+    }
+
+    int out_count = 0;
+    for (int ix = 0; ix < count; ++ix)
+    {
+        const SMF_Rect *rect = rects + ix;
+        SDL_Rect r = {rect->x, rect->y, rect->w, rect->h};
+        SDL_Rect visible;
+        if (!SDL_IntersectRect(&r, &cull, &visible))
+        {
+            continue;
+        }
+
+        // a filled rectangle can be cut down to what is visible, an outline has to keep its edges where they are
+        out[out_count++] = type == SMF_RENDER_COMMAND_FILL_RECTS ? visible : r;
+    }
+
+    if (out_count == 0)
+    {
+        return 0;
+    }
+
+    SMF_RenderCommand *cmd = PushCommand(type);
+    if (!cmd)
+    {
+        return -1;
+    }
+
+    cmd->data = out;
+    cmd->count = out_count;
+
+    return 0;
+}
+
+int SMF_RenderFillRects(int count, const SMF_Rect *rects)
+{
+    return PushRectsCommand(SMF_RENDER_COMMAND_FILL_RECTS, count, rects);
+}
+
+int SMF_RenderRects(int count, const SMF_Rect *rects)
+{
+    return PushRectsCommand(SMF_RENDER_COMMAND_RECTS, count, rects);
+}
+
+// the Cohen-Sutherland region of a point relative to a rectangle (0 when it is inside)
+static int GetOutcode(const SMF_Point *point, const SDL_Rect *rect)
+{
+    int code = 0;
+    code |= point->x < rect->x ? 1 : (point->x >= rect->x + rect->w ? 2 : 0);
+    code |= point->y < rect->y ? 4 : (point->y >= rect->y + rect->h ? 8 : 0);
+    return code;
+}
+
+static int PushLinesCommand(const SDL_Point *points, int count)
+{
+    SMF_RenderCommand *cmd = PushCommand(SMF_RENDER_COMMAND_LINES);
+    if (!cmd)
+    {
+        return -1;
+    }
+
+    cmd->data = points;
+    cmd->count = count;
+
+    return 0;
+}
+
+int SMF_RenderLines(int count, const SMF_Point *points)
+{
+    if (ValidateBatchArgs(count, points, "points") == -1)
+    {
+        return -1;
+    }
+
+    if (count < 2)
+    {
+        return 0;
+    }
+
+    SDL_Rect cull;
+    if (GetCullRect(&cull) == -1)
+    {
+        return -1;
+    }
+
+    SDL_Point *out = SMF_FrameAlloc(sizeof(SDL_Point) * (size_t)count);
+    if (!out)
+    {
+        return -1;
+    }
+
+    // segments entirely on the outside of one edge are dropped, which splits the line into runs of connected
+    // segments (the segments that are kept stay whole so they rasterize exactly as they would without culling)
+    int run_start = 0;
+    int out_count = 0;
+    int prev_code = GetOutcode(points, &cull);
+    for (int ix = 1; ix < count; ++ix)
+    {
+        int code = GetOutcode(points + ix, &cull);
+        if ((prev_code & code) == 0)
+        {
+            if (out_count == run_start)
+            {
+                out[out_count].x = points[ix - 1].x;
+                out[out_count].y = points[ix - 1].y;
+                out_count++;
+            }
+
+            out[out_count].x = points[ix].x;
+            out[out_count].y = points[ix].y;
+            out_count++;
+        }
+        else if (out_count > run_start)
+        {
+            if (PushLinesCommand(out + run_start, out_count - run_start) == -1)
+            {
+                return -1;
+            }
+
+            run_start = out_count;
+        }
+
+        prev_code = code;
+    }
+
+    if (out_count > run_start)
+    {
+        return PushLinesCommand(out + run_start, out_count - run_start);
+    }
+
+    return 0;
+}
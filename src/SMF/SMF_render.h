@@ -0,0 +1,13 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+void SMF_CleanRender(void);
+
+uint64_t SMF_GetFrameNumber(void);
+
+int SMF_PushImageCommand(SMF_Handle image, int x, int y);
+int SMF_PushTextGridCommand(SMF_Handle grid, int x, int y);
+int SMF_PushNineSliceCommand(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, int count,
+                             const SDL_Rect *panel, SDL_Texture *cache);
@@ -0,0 +1,627 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_replay.h"
+
+#include "SMF_context.h"
+#include "SMF_input.h"
+#include "SMF_mem.h"
+
+// the log starts with a header (magic, version, the tick count when recording started) followed by records, where
+// every record is a kind byte and the microseconds since the previous record (both as varints), and event records
+// add the event type and its fields (signed fields are zigzag encoded so small negative values stay small)
+#define SMF_REPLAY_MAGIC "SMFI"
+#define SMF_REPLAY_VERSION 1
+
+#define SMF_REPLAY_RECORD_EVENT 1
+#define SMF_REPLAY_RECORD_FRAME 2
+
+#define SMF_REPLAY_MAX_RECORD_SIZE 64
+
+typedef struct SMF_Recording
+{
+    FILE *file;
+    uint64_t start_counter;
+    uint64_t last_us;
+} SMF_Recording;
+
+typedef struct SMF_Replay
+{
+    uint8_t *data;
+    size_t size;
+    size_t pos;
+    uint64_t start_ticks;
+    uint64_t clock_us;
+    int is_quit_sent;
+    char *report_path;
+    uint64_t last_present_counter;
+    uint32_t *frame_times;
+    size_t frames_len;
+    size_t frames_cap;
+} SMF_Replay;
+
+static SMF_Recording g_recording;
+static int g_is_recording = 0;
+static SMF_Replay g_replay;
+static int g_is_replaying = 0;
+
+static uint64_t CounterToMicroseconds(uint64_t counter)
+{
+    // split the conversion so counters with a nanosecond frequency do not overflow after a few seconds
+    uint64_t freq = SDL_GetPerformanceFrequency();
+    return (counter / freq) * 1000000 + (counter % freq) * 1000000 / freq;
+}
+
+static size_t PutVarint(uint8_t *buf, uint64_t value)
+{
+    size_t len = 0;
+    while (value >= 0x80)
+    {
+        buf[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+
+    buf[len++] = (uint8_t)value;
+    return len;
+}
+
+static size_t PutSigned(uint8_t *buf, int64_t value)
+{
+    return PutVarint(buf, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static int GetVarint(SMF_Replay *replay, uint64_t *out)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (replay->pos >= replay->size)
+        {
+            return -1;
+        }
+
+        uint8_t byte = replay->data[replay->pos++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *out = value;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static int GetSigned(SMF_Replay *replay, int *out)
+{
+    uint64_t value = 0;
+    if (GetVarint(replay, &value) == -1)
+    {
+        return -1;
+    }
+
+    *out = (int)(int64_t)((value >> 1) ^ (~(value & 1) + 1));
+    return 0;
+}
+
+static size_t EncodeEvent(uint8_t *buf, const SMF_Event *event)
+{
+    size_t len = PutVarint(buf, (uint64_t)event->type);
+
+    switch (event->type)
+    {
+    case SMF_EVENT_TYPE_MOUSE_ENTER:
+        len += PutSigned(buf + len, event->mouse_enter.x);
+        len += PutSigned(buf + len, event->mouse_enter.y);
+        break;
+    case SMF_EVENT_TYPE_MOUSE_MOVE:
+        len += PutSigned(buf + len, event->mouse_move.x);
+        len += PutSigned(buf + len, event->mouse_move.y);
+        len += PutSigned(buf + len, event->mouse_move.dx);
+        len += PutSigned(buf + len, event->mouse_move.dy);
+        break;
+    case SMF_EVENT_TYPE_MOUSE_PRESS:
+    case SMF_EVENT_TYPE_MOUSE_RELEASE:
+    case SMF_EVENT_TYPE_MOUSE_CLICK:
+    case SMF_EVENT_TYPE_MOUSE_DOUBLE_CLICK:
+        len += PutSigned(buf + len, event->mouse_button.x);
+        len += PutSigned(buf + len, event->mouse_button.y);
+        len += PutVarint(buf + len, (uint64_t)event->mouse_button.button);
+        break;
+    case SMF_EVENT_TYPE_MOUSE_SCROLL:
+        len += PutSigned(buf + len, event->mouse_scroll.x);
+        len += PutSigned(buf + len, event->mouse_scroll.y);
+        len += PutSigned(buf + len, event->mouse_scroll.scroll_x);
+        len += PutSigned(buf + len, event->mouse_scroll.scroll_y);
+        break;
+    case SMF_EVENT_TYPE_KEY_DOWN:
+    case SMF_EVENT_TYPE_KEY_UP:
+        len += PutVarint(buf + len, (uint32_t)event->key.key);
+        len += PutVarint(buf + len, (uint64_t)event->key.mods);
+        break;
+    case SMF_EVENT_TYPE_TEXT_INPUT: {
+        size_t text_len = strnlen(event->text_input.text, sizeof(event->text_input.text) - 1);
+        buf[len++] = (uint8_t)text_len;
+        memcpy(buf + len, event->text_input.text, text_len);
+        len += text_len;
+        break;
+    }
+    default:
+        break;
+    }
+
+    return len;
+}
+
+static int DecodeEvent(SMF_Replay *replay, SMF_Event *event)
+{
+    uint64_t type = 0;
+    if (GetVarint(replay, &type) == -1)
+    {
+        return -1;
+    }
+
+    memset(event, 0, sizeof(SMF_Event));
+    event->type = (SMF_EventType)type;
+
+    uint64_t value = 0;
+    int is_valid = 1;
+    switch (event->type)
+    {
+    case SMF_EVENT_TYPE_MOUSE_ENTER:
+        is_valid = GetSigned(replay, &event->mouse_enter.x) == 0 && GetSigned(replay, &event->mouse_enter.y) == 0;
+        break;
+    case SMF_EVENT_TYPE_MOUSE_MOVE:
+        is_valid = GetSigned(replay, &event->mouse_move.x) == 0 && GetSigned(replay, &event->mouse_move.y) == 0 &&
+                   GetSigned(replay, &event->mouse_move.dx) == 0 && GetSigned(replay, &event->mouse_move.dy) == 0;
+        break;
+    case SMF_EVENT_TYPE_MOUSE_PRESS:
+    case SMF_EVENT_TYPE_MOUSE_RELEASE:
+    case SMF_EVENT_TYPE_MOUSE_CLICK:
+    case SMF_EVENT_TYPE_MOUSE_DOUBLE_CLICK:
+        is_valid = GetSigned(replay, &event->mouse_button.x) == 0 && GetSigned(replay, &event->mouse_button.y) == 0 &&
+                   GetVarint(replay, &value) == 0;
+        event->mouse_button.button = (SMF_MouseButton)value;
+        break;
+    case SMF_EVENT_TYPE_MOUSE_SCROLL:
+        is_valid = GetSigned(replay, &event->mouse_scroll.x) == 0 && GetSigned(replay, &event->mouse_scroll.y) == 0 &&
+                   GetSigned(replay, &event->mouse_scroll.scroll_x) == 0 &&
+                   GetSigned(replay, &event->mouse_scroll.scroll_y) == 0;
+        break;
+    case SMF_EVENT_TYPE_KEY_DOWN:
+    case SMF_EVENT_TYPE_KEY_UP:
+        is_valid = GetVarint(replay, &value) == 0;
+        event->key.key = (SMF_Key)(uint32_t)value;
+        is_valid = is_valid && GetVarint(replay, &value) == 0;
+        event->key.mods = (SMF_KeyMod)value;
+        break;
+    case SMF_EVENT_TYPE_TEXT_INPUT: {
+        if (replay->pos >= replay->size)
+        {
+            return -1;
+        }
+
+        size_t text_len = replay->data[replay->pos++];
+        if (text_len >= sizeof(event->text_input.text) || replay->size - replay->pos < text_len)
+        {
+            return -1;
+        }
+
+        memcpy(event->text_input.text, replay->data + replay->pos, text_len);
+        replay->pos += text_len;
+        break;
+    }
+    default:
+        break;
+    }
+
+    return is_valid ? 0 : -1;
+}
+
+static void WriteRecord(int kind, const SMF_Event *event)
+{
+    uint64_t now_us = CounterToMicroseconds(SDL_GetPerformanceCounter() - g_recording.start_counter);
+
+    uint8_t buf[SMF_REPLAY_MAX_RECORD_SIZE];
+    size_t len = PutVarint(buf, (uint64_t)kind);
+    len += PutVarint(buf + len, now_us - g_recording.last_us);
+    if (event)
+    {
+        len += EncodeEvent(buf + len, event);
+    }
+
+    g_recording.last_us = now_us;
+
+    if (fwrite(buf, 1, len, g_recording.file) != len)
+    {
+        // a failing disk should not take the application down with it, so the recording just ends here
+        SMF_SetError("failed to write the input recording");
+        fclose(g_recording.file);
+        g_is_recording = 0;
+    }
+}
+
+void SMF_RecordEvents(const SMF_Event *events, int count)
+{
+    for (int ix = 0; ix < count && g_is_recording; ++ix)
+    {
+        // user events come from the application's own threads (which run again during a replay) and carry pointers
+        // that mean nothing in another run, and render target resets depend on the renderer of this run, so neither
+        // is recorded
+        if (events[ix].type != SMF_EVENT_TYPE_USER && events[ix].type != SMF_EVENT_TYPE_RENDER_TARGETS_RESET)
+        {
+            WriteRecord(SMF_REPLAY_RECORD_EVENT, events + ix);
+        }
+    }
+}
+
+int SMF_StartInputRecording(const char *path)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!path)
+    {
+        return SMF_InvalidArgError("path");
+    }
+
+    if (g_is_replaying)
+    {
+        return SMF_SetError("cannot record input during a replay");
+    }
+
+    SMF_StopInputRecording();
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        return SMF_SetError("failed to open '%s' for writing", path);
+    }
+
+    uint8_t header[4 + SMF_REPLAY_MAX_RECORD_SIZE];
+    memcpy(header, SMF_REPLAY_MAGIC, 4);
+    size_t len = 4 + PutVarint(header + 4, SMF_REPLAY_VERSION);
+    len += PutVarint(header + len, SMF_GetTicks());
+    if (fwrite(header, 1, len, file) != len)
+    {
+        fclose(file);
+        return SMF_SetError("failed to write to '%s'", path);
+    }
+
+    g_recording.file = file;
+    g_recording.start_counter = SDL_GetPerformanceCounter();
+    g_recording.last_us = 0;
+    g_is_recording = 1;
+
+    return 0;
+}
+
+int SMF_StopInputRecording(void)
+{
+    if (!g_is_recording)
+    {
+        return 0;
+    }
+
+    g_is_recording = 0;
+    if (fclose(g_recording.file) != 0)
+    {
+        return SMF_SetError("failed to write the input recording");
+    }
+
+    return 0;
+}
+
+int SMF_IsReplaying(void)
+{
+    return g_is_replaying;
+}
+
+uint64_t SMF_GetReplayTicks(void)
+{
+    return g_replay.start_ticks + g_replay.clock_us / 1000;
+}
+
+// reads the header of the next record (the kind and the time), leaving the position after it
+static int ReadRecordHeader(uint64_t *kind)
+{
+    uint64_t delta_us = 0;
+    if (GetVarint(&g_replay, kind) == -1 || GetVarint(&g_replay, &delta_us) == -1)
+    {
+        return -1;
+    }
+
+    g_replay.clock_us += delta_us;
+    return 0;
+}
+
+int SMF_ReplayEvent(SMF_Event *event)
+{
+    // the events recorded before a frame was presented are handed out in the same frame of the replay, so every
+    // replayed frame sees exactly the events (and times) its recorded counterpart did
+    while (g_replay.pos < g_replay.size)
+    {
+        size_t start = g_replay.pos;
+        uint64_t clock_us = g_replay.clock_us;
+
+        uint64_t kind = 0;
+        if (ReadRecordHeader(&kind) == -1)
+        {
+            break;
+        }
+
+        if (kind == SMF_REPLAY_RECORD_FRAME)
+        {
+            g_replay.pos = start;
+            g_replay.clock_us = clock_us;
+            return 0;
+        }
+
+        if (kind != SMF_REPLAY_RECORD_EVENT || DecodeEvent(&g_replay, event) == -1)
+        {
+            break;
+        }
+
+        SMF_ApplyReplayedEvent(event);
+        return 1;
+    }
+
+    // a truncated log (such as one from a crashed session) simply ends the replay early
+    g_replay.pos = g_replay.size;
+    if (!g_replay.is_quit_sent)
+    {
+        g_replay.is_quit_sent = 1;
+        memset(event, 0, sizeof(SMF_Event));
+        event->type = SMF_EVENT_TYPE_QUIT;
+        return 1;
+    }
+
+    return 0;
+}
+
+static void SkipToNextFrame(void)
+{
+    SMF_Event event;
+    while (g_replay.pos < g_replay.size)
+    {
+        uint64_t kind = 0;
+        if (ReadRecordHeader(&kind) == -1)
+        {
+            g_replay.pos = g_replay.size;
+            return;
+        }
+
+        if (kind == SMF_REPLAY_RECORD_FRAME)
+        {
+            return;
+        }
+
+        if (kind != SMF_REPLAY_RECORD_EVENT || DecodeEvent(&g_replay, &event) == -1)
+        {
+            g_replay.pos = g_replay.size;
+            return;
+        }
+    }
+}
+
+static void AddFrameTime(uint32_t frame_us)
+{
+    if (g_replay.frames_len == g_replay.frames_cap)
+    {
+        size_t new_cap = g_replay.frames_cap == 0 ? 1024 : g_replay.frames_cap * 2;
+        uint32_t *new_times = SMF_Calloc(new_cap, sizeof(uint32_t));
+        if (!new_times)
+        {
+            return;
+        }
+
+        if (g_replay.frame_times)
+        {
+            memcpy(new_times, g_replay.frame_times, g_replay.frames_len * sizeof(uint32_t));
+            SMF_Free(g_replay.frame_times);
+        }
+
+        g_replay.frame_times = new_times;
+        g_replay.frames_cap = new_cap;
+    }
+
+    g_replay.frame_times[g_replay.frames_len++] = frame_us;
+}
+
+void SMF_OnFramePresented(void)
+{
+    if (g_is_recording)
+    {
+        WriteRecord(SMF_REPLAY_RECORD_FRAME, NULL);
+    }
+
+    if (g_is_replaying)
+    {
+        // frame times are measured between presents, so the first present only starts the clock
+        uint64_t counter = SDL_GetPerformanceCounter();
+        if (g_replay.last_present_counter != 0)
+        {
+            uint64_t frame_us = CounterToMicroseconds(counter - g_replay.last_present_counter);
+            AddFrameTime(frame_us > UINT32_MAX ? UINT32_MAX : (uint32_t)frame_us);
+        }
+
+        g_replay.last_present_counter = counter;
+
+        // events the application did not poll before presenting are dropped along with their frame
+        SkipToNextFrame();
+    }
+}
+
+int SMF_StartInputReplay(const char *path, const char *report_path)
+{
+    if (SMF_IsNotInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!path)
+    {
+        return SMF_InvalidArgError("path");
+    }
+
+    size_t size = 0;
+    uint8_t *data = SDL_LoadFile(path, &size);
+    if (!data)
+    {
+        return SMF_SDLError();
+    }
+
+    SMF_Replay replay;
+    memset(&replay, 0, sizeof(replay));
+    replay.data = data;
+    replay.size = size;
+
+    uint64_t version = 0;
+    if (size < 4 || memcmp(data, SMF_REPLAY_MAGIC, 4) != 0)
+    {
+        SDL_free(data);
+        return SMF_SetError("'%s' is not an input recording", path);
+    }
+
+    replay.pos = 4;
+    if (GetVarint(&replay, &version) == -1 || version != SMF_REPLAY_VERSION ||
+        GetVarint(&replay, &replay.start_ticks) == -1)
+    {
+        SDL_free(data);
+        return SMF_SetError("unsupported input recording '%s'", path);
+    }
+
+    if (report_path)
+    {
+        size_t len = strlen(report_path);
+        replay.report_path = SMF_Calloc(len + 1, 1);
+        if (!replay.report_path)
+        {
+            SDL_free(data);
+            return -1;
+        }
+
+        memcpy(replay.report_path, report_path, len);
+    }
+
+    // replays run offscreen, so they can run on build machines without a display
+    SDL_SetHintWithPriority(SDL_HINT_VIDEODRIVER, "dummy", SDL_HINT_OVERRIDE);
+
+    SMF_CleanReplay();
+    g_replay = replay;
+    g_is_replaying = 1;
+
+    return 0;
+}
+
+static int CompareFrameTimes(const void *a, const void *b)
+{
+    uint32_t lhs = *(const uint32_t *)a;
+    uint32_t rhs = *(const uint32_t *)b;
+    return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+}
+
+int SMF_GetReplayStats(SMF_ReplayStats *stats)
+{
+    if (!stats)
+    {
+        return SMF_InvalidArgError("stats");
+    }
+
+    memset(stats, 0, sizeof(SMF_ReplayStats));
+
+    size_t len = g_replay.frames_len;
+    if (len == 0)
+    {
+        return 0;
+    }
+
+    uint32_t *sorted = SMF_Calloc(len, sizeof(uint32_t));
+    if (!sorted)
+    {
+        return -1;
+    }
+
+    memcpy(sorted, g_replay.frame_times, len * sizeof(uint32_t));
+    qsort(sorted, len, sizeof(uint32_t), CompareFrameTimes);
+
+    uint64_t total = 0;
+    for (size_t ix = 0; ix < len; ++ix)
+    {
+        total += sorted[ix];
+    }
+
+    stats->frames = len;
+    stats->mean_us = total / len;
+    stats->p50_us = sorted[(len - 1) * 50 / 100];
+    stats->p95_us = sorted[(len - 1) * 95 / 100];
+    stats->p99_us = sorted[(len - 1) * 99 / 100];
+    stats->max_us = sorted[len - 1];
+
+    SMF_Free(sorted);
+
+    return 0;
+}
+
+static void WriteReport(void)
+{
+    FILE *file = fopen(g_replay.report_path, "w");
+    if (!file)
+    {
+        SMF_SetError("failed to open '%s' for writing", g_replay.report_path);
+        return;
+    }
+
+    // a summary followed by every frame time, so reports from two builds can be compared as a whole or frame by
+    // frame (the same log replays the same frames)
+    SMF_ReplayStats stats;
+    SMF_GetReplayStats(&stats);
+    fprintf(file, "frames %llu\n", (unsigned long long)stats.frames);
+    fprintf(file, "mean_us %llu\n", (unsigned long long)stats.mean_us);
+    fprintf(file, "p50_us %llu\n", (unsigned long long)stats.p50_us);
+    fprintf(file, "p95_us %llu\n", (unsigned long long)stats.p95_us);
+    fprintf(file, "p99_us %llu\n", (unsigned long long)stats.p99_us);
+    fprintf(file, "max_us %llu\n", (unsigned long long)stats.max_us);
+    fprintf(file, "frame,time_us\n");
+    for (size_t ix = 0; ix < g_replay.frames_len; ++ix)
+    {
+        fprintf(file, "%zu,%u\n", ix, (unsigned)g_replay.frame_times[ix]);
+    }
+
+    if (fclose(file) != 0)
+    {
+        SMF_SetError("failed to write '%s'", g_replay.report_path);
+    }
+}
+
+void SMF_CleanReplay(void)
+{
+    SMF_StopInputRecording();
+
+    if (!g_is_replaying)
+    {
+        return;
+    }
+
+    if (g_replay.report_path)
+    {
+        WriteReport();
+        SMF_Free(g_replay.report_path);
+    }
+
+    SMF_Free(g_replay.frame_times);
+    SDL_free(g_replay.data);
+    memset(&g_replay, 0, sizeof(g_replay));
+    g_is_replaying = 0;
+}
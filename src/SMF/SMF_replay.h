@@ -0,0 +1,13 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+int SMF_IsReplaying(void);
+int SMF_ReplayEvent(SMF_Event *event);
+uint64_t SMF_GetReplayTicks(void);
+
+void SMF_RecordEvents(const SMF_Event *events, int count);
+void SMF_OnFramePresented(void);
+
+void SMF_CleanReplay(void);
@@ -0,0 +1,196 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_sdf.h"
+
+#include "SMF_context.h"
+#include "SMF_image.h"
+#include "SMF_mem.h"
+
+#define SDF_INF 1e20f
+
+// exact 1D squared euclidean distance transform (Felzenszwalb & Huttenlocher) of n samples spaced by stride
+static void TransformLine(float *grid, int n, int stride, float *f, int *v, float *z)
+{
+    for (int ix = 0; ix < n; ++ix)
+    {
+        f[ix] = grid[ix * stride];
+    }
+
+    int k = 0;
+    v[0] = 0;
+    z[0] = -SDF_INF;
+    z[1] = SDF_INF;
+
+    for (int q = 1; q < n; ++q)
+    {
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        while (s <= z[k])
+        {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        }
+
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = SDF_INF;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; ++q)
+    {
+        while (z[k + 1] < q)
+        {
+            k++;
+        }
+
+        float d = (float)(q - v[k]);
+        grid[q * stride] = d * d + f[v[k]];
+    }
+}
+
+static void TransformGrid(float *grid, int w, int h, float *f, int *v, float *z)
+{
+    for (int x = 0; x < w; ++x)
+    {
+        TransformLine(grid + x, h, w, f, v, z);
+    }
+
+    for (int y = 0; y < h; ++y)
+    {
+        TransformLine(grid + y * w, w, 1, f, v, z);
+    }
+}
+
+int SMF_BuildDistanceField(SDL_Surface *surface, uint8_t *field)
+{
+    if (surface->format->format != SDL_PIXELFORMAT_INDEX8)
+    {
+        return SMF_SetError("glyph surface is not 8-bit coverage");
+    }
+
+    int w = surface->w + SMF_SDF_SPREAD * 2;
+    int h = surface->h + SMF_SDF_SPREAD * 2;
+    int n = w > h ? w : h;
+
+    // two grids (distance to the outside and to the inside) plus the scratch space of the 1D transform
+    float *outside = SMF_Calloc((size_t)w * h * 2 + n * 2 + 1, sizeof(float));
+    int *v = SMF_Calloc(n, sizeof(int));
+    if (!outside || !v)
+    {
+        SMF_Free(outside);
+        SMF_Free(v);
+        return -1;
+    }
+
+    float *inside = outside + (size_t)w * h;
+    float *f = inside + (size_t)w * h;
+    float *z = f + n;
+
+    if (SDL_LockSurface(surface) == -1)
+    {
+        SMF_Free(outside);
+        SMF_Free(v);
+        return SMF_SDLError();
+    }
+
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            int sx = x - SMF_SDF_SPREAD;
+            int sy = y - SMF_SDF_SPREAD;
+
+            int is_inside = 0;
+            if (sx >= 0 && sy >= 0 && sx < surface->w && sy < surface->h)
+            {
+                const Uint8 *row = (const Uint8 *)surface->pixels + sy * surface->pitch;
+                is_inside = row[sx] >= 128;
+            }
+
+            outside[y * w + x] = is_inside ? SDF_INF : 0.0f;
+            inside[y * w + x] = is_inside ? 0.0f : SDF_INF;
+        }
+    }
+
+    SDL_UnlockSurface(surface);
+
+    TransformGrid(outside, w, h, f, v, z);
+    TransformGrid(inside, w, h, f, v, z);
+
+    // the outline lies halfway between an inside and an outside pixel, 128 marks it in the stored field
+    for (int ix = 0; ix < w * h; ++ix)
+    {
+        float d = outside[ix] > 0.0f ? SDL_sqrtf(outside[ix]) - 0.5f : 0.5f - SDL_sqrtf(inside[ix]);
+        float value = 128.0f + d * (127.0f / SMF_SDF_SPREAD);
+        field[ix] = (uint8_t)(value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value + 0.5f));
+    }
+
+    SMF_Free(outside);
+    SMF_Free(v);
+
+    return 0;
+}
+
+static float SampleField(const uint8_t *field, int w, int h, float x, float y)
+{
+    x = x < 0.0f ? 0.0f : (x > w - 1 ? (float)(w - 1) : x);
+    y = y < 0.0f ? 0.0f : (y > h - 1 ? (float)(h - 1) : y);
+
+    int x0 = (int)x;
+    int y0 = (int)y;
+    int x1 = x0 + 1 < w ? x0 + 1 : x0;
+    int y1 = y0 + 1 < h ? y0 + 1 : y0;
+    float fx = x - x0;
+    float fy = y - y0;
+
+    float top = field[y0 * w + x0] + (field[y0 * w + x1] - field[y0 * w + x0]) * fx;
+    float bottom = field[y1 * w + x0] + (field[y1 * w + x1] - field[y1 * w + x0]) * fx;
+
+    return top + (bottom - top) * fy;
+}
+
+SDL_Surface *SMF_ExpandDistanceField(const uint8_t *field, int field_w, int field_h, int size, int reference_size)
+{
+    float scale = (float)size / reference_size;
+
+    int w = (int)SDL_ceilf((field_w - SMF_SDF_SPREAD * 2) * scale);
+    int h = (int)SDL_ceilf((field_h - SMF_SDF_SPREAD * 2) * scale);
+    if (w <= 0 || h <= 0)
+    {
+        SMF_SetError("glyph is empty");
+        return NULL;
+    }
+
+    SDL_Surface *surface = SMF_CreateCoverageSurface(w, h);
+    if (!surface)
+    {
+        return NULL;
+    }
+
+    // one output pixel covers 1 / scale reference pixels, so the distance is converted to output pixels and the
+    // smoothstep runs across a single output pixel around the outline
+    float to_output = scale * SMF_SDF_SPREAD / 127.0f;
+    for (int y = 0; y < h; ++y)
+    {
+        Uint8 *row = (Uint8 *)surface->pixels + y * surface->pitch;
+        float fy = (y + 0.5f) / scale - 0.5f + SMF_SDF_SPREAD;
+
+        for (int x = 0; x < w; ++x)
+        {
+            float fx = (x + 0.5f) / scale - 0.5f + SMF_SDF_SPREAD;
+            float d = (SampleField(field, field_w, field_h, fx, fy) - 128.0f) * to_output;
+
+            float t = d + 0.5f;
+            t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+            row[x] = (Uint8)(t * t * (3.0f - 2.0f * t) * 255.0f + 0.5f);
+        }
+    }
+
+    return surface;
+}
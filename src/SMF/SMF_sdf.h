@@ -0,0 +1,11 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// distance (in pixels of the reference size) covered by the 0..255 range of a distance field, this is also the
+// padding around each glyph so the field can fade out past the outline
+#define SMF_SDF_SPREAD 6
+
+int SMF_BuildDistanceField(SDL_Surface *surface, uint8_t *field);
+SDL_Surface *SMF_ExpandDistanceField(const uint8_t *field, int field_w, int field_h, int size, int reference_size);
@@ -0,0 +1,468 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <stdint.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_shape.h"
+
+#include "SMF_context.h"
+#include "SMF_hash_map.h"
+#include "SMF_image.h"
+#include "SMF_mem.h"
+#include "SMF_render.h"
+#include "SMF_window.h"
+
+// the largest extent (in pixels) of a shape, which keeps every dimension within a 20-bit field of the cache key
+#define SMF_SHAPE_MAX_SIZE 4096
+
+// the amount of coverage kept around for shapes that are no longer drawn every frame
+#define SMF_SHAPE_CACHE_BUDGET (4 * 1024 * 1024)
+
+#define SMF_SHAPE_ROUNDED_RECT 1
+#define SMF_SHAPE_LINE 2
+
+#define SHAPE_KEY(Kind, A, B, C)                                                                                       \
+    (((uint64_t)(Kind) << 60) | ((uint64_t)(A) << 40) | ((uint64_t)(B) << 20) | (uint64_t)(C))
+
+// a box (with rounded corners) around a center, along the u axis and the v axis perpendicular to it
+typedef struct SMF_Shape
+{
+    float cx, cy;
+    float ux, uy;
+    float hu, hv;
+    float radius;
+} SMF_Shape;
+
+// cache entry for the coverage of a shape (these can be evicted and re-rasterized)
+typedef struct SMF_ShapeCacheEntry
+{
+    struct SMF_ShapeCacheEntry *prev;
+    struct SMF_ShapeCacheEntry *next;
+    uint64_t key;
+    SMF_Handle image;
+    size_t size;
+    uint64_t frame;
+} SMF_ShapeCacheEntry;
+
+static SMF_HashMap *g_shape_map = NULL;
+
+// shape cache entries in least-recently-used order (the head is the most recently used)
+static SMF_ShapeCacheEntry *g_shape_cache_head = NULL;
+static SMF_ShapeCacheEntry *g_shape_cache_tail = NULL;
+static size_t g_shape_cache_size = 0;
+
+static void LinkShapeCacheEntry(SMF_ShapeCacheEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = g_shape_cache_head;
+    if (g_shape_cache_head)
+    {
+        g_shape_cache_head->prev = entry;
+    }
+    else
+    {
+        g_shape_cache_tail = entry;
+    }
+
+    g_shape_cache_head = entry;
+    entry->frame = SMF_GetFrameNumber();
+}
+
+static void UnlinkShapeCacheEntry(SMF_ShapeCacheEntry *entry)
+{
+    if (entry->prev)
+    {
+        entry->prev->next = entry->next;
+    }
+    else
+    {
+        g_shape_cache_head = entry->next;
+    }
+
+    if (entry->next)
+    {
+        entry->next->prev = entry->prev;
+    }
+    else
+    {
+        g_shape_cache_tail = entry->prev;
+    }
+}
+
+static void DestroyShapeCacheEntry(SMF_ShapeCacheEntry *entry)
+{
+    UnlinkShapeCacheEntry(entry);
+    SMF_DestroyImage(entry->image);
+    g_shape_cache_size -= entry->size;
+    SMF_Free(entry);
+}
+
+static void EvictShapes(void)
+{
+    // shapes used during the current frame are still referenced by pending render commands
+    uint64_t frame = SMF_GetFrameNumber();
+    while (g_shape_cache_size > SMF_SHAPE_CACHE_BUDGET && g_shape_cache_tail && g_shape_cache_tail->frame != frame)
+    {
+        SMF_ShapeCacheEntry *entry = g_shape_cache_tail;
+        SMF_RemoveHashMapEntry(g_shape_map, entry->key);
+        DestroyShapeCacheEntry(entry);
+    }
+}
+
+// signed distance from a point to the outline of a shape (negative inside)
+static float GetShapeDistance(const SMF_Shape *shape, float x, float y)
+{
+    float dx = x - shape->cx;
+    float dy = y - shape->cy;
+    float qu = SDL_fabsf(dx * shape->ux + dy * shape->uy) - (shape->hu - shape->radius);
+    float qv = SDL_fabsf(dy * shape->ux - dx * shape->uy) - (shape->hv - shape->radius);
+
+    float ou = qu > 0.0f ? qu : 0.0f;
+    float ov = qv > 0.0f ? qv : 0.0f;
+    float in = qu > qv ? qu : qv;
+
+    return SDL_sqrtf(ou * ou + ov * ov) + (in < 0.0f ? in : 0.0f) - shape->radius;
+}
+
+// intersects the row at y with the slab |a * x + b| <= extent
+static int ClipSlab(float a, float b, float extent, float *lo, float *hi)
+{
+    if (SDL_fabsf(a) < 1e-6f)
+    {
+        return SDL_fabsf(b) <= extent;
+    }
+
+    float x0 = (-extent - b) / a;
+    float x1 = (extent - b) / a;
+    if (x0 > x1)
+    {
+        float tmp = x0;
+        x0 = x1;
+        x1 = tmp;
+    }
+
+    *lo = x0 > *lo ? x0 : *lo;
+    *hi = x1 < *hi ? x1 : *hi;
+
+    return *lo <= *hi;
+}
+
+// the part of the row at y where the shape grown by offset lies (the span is exact when growing axis-aligned shapes
+// and when shrinking any shape, rotated shapes have no rounded corners and are only bounded when grown)
+static int GetShapeSpan(const SMF_Shape *shape, float y, float offset, float *lo, float *hi)
+{
+    float hu = shape->hu + offset;
+    float hv = shape->hv + offset;
+    if (hu <= 0.0f || hv <= 0.0f)
+    {
+        return 0;
+    }
+
+    float dy = y - shape->cy;
+
+    if (shape->uy == 0.0f)
+    {
+        float radius = shape->radius + offset;
+        radius = radius > 0.0f ? radius : 0.0f;
+
+        float ady = SDL_fabsf(dy);
+        if (ady > hv)
+        {
+            return 0;
+        }
+
+        float half = hu;
+        float t = ady - (hv - radius);
+        if (t > 0.0f)
+        {
+            half = hu - radius + SDL_sqrtf(radius * radius - t * t);
+        }
+
+        *lo = shape->cx - half;
+        *hi = shape->cx + half;
+
+        return 1;
+    }
+
+    *lo = -1e30f;
+    *hi = 1e30f;
+    if (!ClipSlab(shape->ux, dy * shape->uy, hu, lo, hi) || !ClipSlab(-shape->uy, dy * shape->ux, hv, lo, hi))
+    {
+        return 0;
+    }
+
+    *lo += shape->cx;
+    *hi += shape->cx;
+
+    return 1;
+}
+
+static int ClampSpan(float lo, float hi, int w, int *x0, int *x1)
+{
+    // a pixel belongs to a span when its center does
+    *x0 = (int)SDL_ceilf(lo - 0.5f);
+    *x1 = (int)SDL_floorf(hi - 0.5f);
+    *x0 = *x0 > 0 ? *x0 : 0;
+    *x1 = *x1 < w - 1 ? *x1 : w - 1;
+
+    return *x0 <= *x1;
+}
+
+// rows are split into coverage spans: pixels whose center is half a pixel inside the outline are filled, pixels
+// half a pixel outside are left empty and only the band in between gets its coverage from the distance
+static void RasterizeShape(const SMF_Shape *shape, SDL_Surface *surface)
+{
+    for (int y = 0; y < surface->h; ++y)
+    {
+        uint8_t *row = (uint8_t *)surface->pixels + (size_t)y * surface->pitch;
+        float py = y + 0.5f;
+
+        float lo = 0.0f;
+        float hi = 0.0f;
+        int x0 = 0;
+        int x1 = 0;
+        if (!GetShapeSpan(shape, py, 0.5f, &lo, &hi) || !ClampSpan(lo, hi, surface->w, &x0, &x1))
+        {
+            continue;
+        }
+
+        int inner_x0 = 0;
+        int inner_x1 = 0;
+        if (GetShapeSpan(shape, py, -0.5f, &lo, &hi) && ClampSpan(lo, hi, surface->w, &inner_x0, &inner_x1))
+        {
+            memset(row + inner_x0, 0xff, (size_t)(inner_x1 - inner_x0 + 1));
+        }
+        else
+        {
+            inner_x0 = x1 + 1;
+        }
+
+        for (int x = x0; x <= x1; ++x)
+        {
+            if (x == inner_x0)
+            {
+                x = inner_x1;
+                continue;
+            }
+
+            float coverage = 0.5f - GetShapeDistance(shape, x + 0.5f, py);
+            coverage = coverage < 0.0f ? 0.0f : (coverage > 1.0f ? 1.0f : coverage);
+            row[x] = (uint8_t)(coverage * 255.0f + 0.5f);
+        }
+    }
+}
+
+static SMF_Handle GetShapeImage(uint64_t key, const SMF_Shape *shape, int w, int h)
+{
+    if (!g_shape_map)
+    {
+        g_shape_map = SMF_CreateHashMap();
+        if (!g_shape_map)
+        {
+            return SMF_INVALID_HANDLE;
+        }
+    }
+
+    SMF_ShapeCacheEntry *entry = NULL;
+    if (SMF_FindHashMapEntry(g_shape_map, key, (void **)&entry) == 1)
+    {
+        UnlinkShapeCacheEntry(entry);
+        LinkShapeCacheEntry(entry);
+        return entry->image;
+    }
+
+    entry = SMF_Calloc(1, sizeof(SMF_ShapeCacheEntry));
+    if (!entry)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    SDL_Surface *surface = SMF_CreateCoverageSurface(w, h);
+    if (!surface)
+    {
+        SMF_Free(entry);
+        return SMF_INVALID_HANDLE;
+    }
+
+    RasterizeShape(shape, surface);
+
+    size_t size = (size_t)surface->pitch * surface->h;
+
+    SMF_Handle image = SMF_CreateCoverageImage(surface, SMF_MEMORY_SHAPE_SURFACES);
+    if (image == SMF_INVALID_HANDLE)
+    {
+        SDL_FreeSurface(surface);
+        SMF_Free(entry);
+        return SMF_INVALID_HANDLE;
+    }
+
+    if (SMF_InsertHashMapEntry(g_shape_map, key, entry) == -1)
+    {
+        SMF_DestroyImage(image);
+        SMF_Free(entry);
+        return SMF_INVALID_HANDLE;
+    }
+
+    entry->key = key;
+    entry->image = image;
+    entry->size = size;
+
+    LinkShapeCacheEntry(entry);
+    g_shape_cache_size += size;
+
+    EvictShapes();
+
+    return image;
+}
+
+static int RenderShape(uint64_t key, const SMF_Shape *shape, int x, int y, int w, int h)
+{
+    SMF_Handle image = GetShapeImage(key, shape, w, h);
+    if (image == SMF_INVALID_HANDLE)
+    {
+        return -1;
+    }
+
+    return SMF_PushImageCommand(image, x, y);
+}
+
+static int ValidateShapeArgs(void)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    return SMF_IsWindowCreated();
+}
+
+int SMF_RenderFillRoundedRect(int x, int y, int w, int h, int radius)
+{
+    if (ValidateShapeArgs() == -1)
+    {
+        return -1;
+    }
+
+    if (w < 0)
+    {
+        return SMF_InvalidArgError("w");
+    }
+
+    if (h < 0)
+    {
+        return SMF_InvalidArgError("h");
+    }
+
+    if (radius < 0)
+    {
+        return SMF_InvalidArgError("radius");
+    }
+
+    if (w > SMF_SHAPE_MAX_SIZE || h > SMF_SHAPE_MAX_SIZE)
+    {
+        return SMF_SetError("shapes cannot be larger than %d pixels", SMF_SHAPE_MAX_SIZE);
+    }
+
+    if (w == 0 || h == 0)
+    {
+        return 0;
+    }
+
+    int max_radius = (w < h ? w : h) / 2;
+    radius = radius < max_radius ? radius : max_radius;
+
+    SMF_Shape shape;
+    shape.cx = w * 0.5f;
+    shape.cy = h * 0.5f;
+    shape.ux = 1.0f;
+    shape.uy = 0.0f;
+    shape.hu = w * 0.5f;
+    shape.hv = h * 0.5f;
+    shape.radius = (float)radius;
+
+    return RenderShape(SHAPE_KEY(SMF_SHAPE_ROUNDED_RECT, w, h, radius), &shape, x, y, w, h);
+}
+
+int SMF_RenderFillCircle(int cx, int cy, int radius)
+{
+    if (radius < 0)
+    {
+        return SMF_InvalidArgError("radius");
+    }
+
+    if (radius > SMF_SHAPE_MAX_SIZE / 2)
+    {
+        return SMF_SetError("shapes cannot be larger than %d pixels", SMF_SHAPE_MAX_SIZE);
+    }
+
+    return SMF_RenderFillRoundedRect(cx - radius, cy - radius, radius * 2, radius * 2, radius);
+}
+
+int SMF_RenderThickLine(int x1, int y1, int x2, int y2, int thickness)
+{
+    if (ValidateShapeArgs() == -1)
+    {
+        return -1;
+    }
+
+    if (thickness < 0)
+    {
+        return SMF_InvalidArgError("thickness");
+    }
+
+    int dx = x2 - x1;
+    int dy = y2 - y1;
+    if (thickness > SMF_SHAPE_MAX_SIZE || dx < -SMF_SHAPE_MAX_SIZE || dx > SMF_SHAPE_MAX_SIZE ||
+        dy < -SMF_SHAPE_MAX_SIZE || dy > SMF_SHAPE_MAX_SIZE)
+    {
+        return SMF_SetError("shapes cannot be larger than %d pixels", SMF_SHAPE_MAX_SIZE);
+    }
+
+    if (thickness == 0)
+    {
+        return 0;
+    }
+
+    // the corners of the line can reach past its end points by up to half the diagonal of its cross section
+    int pad = (int)SDL_ceilf(thickness * 0.7072f) + 1;
+    int x = (x1 < x2 ? x1 : x2) - pad;
+    int y = (y1 < y2 ? y1 : y2) - pad;
+    int w = (dx < 0 ? -dx : dx) + 1 + pad * 2;
+    int h = (dy < 0 ? -dy : dy) + 1 + pad * 2;
+
+    // the end points are pixel centers and the ends are squared off by half the thickness, like the pixels of a
+    // regular line
+    float length = SDL_sqrtf((float)(dx * dx + dy * dy));
+
+    SMF_Shape shape;
+    shape.cx = (x1 + x2) * 0.5f + 0.5f - x;
+    shape.cy = (y1 + y2) * 0.5f + 0.5f - y;
+    shape.ux = length > 0.0f ? dx / length : 1.0f;
+    shape.uy = length > 0.0f ? dy / length : 0.0f;
+    shape.hu = (length + thickness) * 0.5f;
+    shape.hv = thickness * 0.5f;
+    shape.radius = 0.0f;
+
+    uint64_t key = SHAPE_KEY(SMF_SHAPE_LINE, dx + SMF_SHAPE_MAX_SIZE, dy + SMF_SHAPE_MAX_SIZE, thickness);
+
+    return RenderShape(key, &shape, x, y, w, h);
+}
+
+void SMF_CleanShapes(void)
+{
+    while (g_shape_cache_head)
+    {
+        DestroyShapeCacheEntry(g_shape_cache_head);
+    }
+
+    if (g_shape_map)
+    {
+        SMF_DestroyHashMap(g_shape_map);
+        g_shape_map = NULL;
+    }
+}
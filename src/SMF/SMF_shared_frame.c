@@ -0,0 +1,254 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_shared_frame.h"
+
+#include "SMF_context.h"
+#include "SMF_mem.h"
+#include "SMF_window.h"
+
+// slots start on a page boundary so a consumer can map a single frame on its own
+#define SMF_SHARED_FRAME_ALIGN 4096
+
+#define ALIGN_SIZE(Size) (((Size) + (SMF_SHARED_FRAME_ALIGN - 1)) & ~(size_t)(SMF_SHARED_FRAME_ALIGN - 1))
+
+#if defined(_WIN32)
+
+void SMF_WriteSharedFrame(SDL_Renderer *renderer)
+{
+}
+
+int SMF_StartSharedFrameOutput(const char *name)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    return SMF_SetError("shared frame output is not supported on this platform");
+}
+
+int SMF_StopSharedFrameOutput(void)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+void SMF_CleanSharedFrames(void)
+{
+}
+
+#else
+
+static SMF_SharedFrameHeader *g_header = NULL;
+static size_t g_mapping_size = 0;
+static char *g_name = NULL;
+
+// the slot only the producer touches, the consumer owns another one and the third is handed back and forth
+static uint32_t g_back_slot = 0;
+static uint64_t g_seq = 0;
+
+static int OpenMapping(const char *name, size_t size)
+{
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+    if (fd == -1)
+    {
+        return SMF_SetError("failed to open shared memory '%s'", name);
+    }
+
+    if (ftruncate(fd, (off_t)size) == -1)
+    {
+        close(fd);
+        shm_unlink(name);
+        return SMF_SetError("failed to size shared memory '%s'", name);
+    }
+
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        shm_unlink(name);
+        return SMF_SetError("failed to map shared memory '%s'", name);
+    }
+
+    g_header = data;
+    g_mapping_size = size;
+
+    return 0;
+}
+
+static void CloseMapping(void)
+{
+    munmap(g_header, g_mapping_size);
+    shm_unlink(g_name);
+}
+
+static void WakeConsumer(void)
+{
+#if defined(__linux__)
+    // the mapping is shared between processes, so this cannot be a private futex
+    syscall(SYS_futex, &g_header->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+void SMF_WriteSharedFrame(SDL_Renderer *renderer)
+{
+    if (!g_header)
+    {
+        return;
+    }
+
+    int w = 0;
+    int h = 0;
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+    if ((uint32_t)w != g_header->width || (uint32_t)h != g_header->height)
+    {
+        return;
+    }
+
+    uint8_t *pixels = (uint8_t *)g_header + g_header->slot_offset[g_back_slot];
+    if (SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_BGRA32, pixels, (int)g_header->stride) == -1)
+    {
+        return;
+    }
+
+    g_seq++;
+    __atomic_store_n(&g_header->slot_seq[g_back_slot], g_seq, __ATOMIC_RELAXED);
+
+    // publish the finished slot and take over whichever slot was waiting (the consumer never holds that one)
+    uint32_t prev = __atomic_exchange_n(&g_header->state, g_back_slot | SMF_SHARED_FRAME_FRESH, __ATOMIC_ACQ_REL);
+    g_back_slot = prev & SMF_SHARED_FRAME_SLOT_MASK;
+
+    __atomic_store_n(&g_header->seq, g_seq, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&g_header->futex, 1, __ATOMIC_RELEASE);
+    WakeConsumer();
+}
+
+int SMF_StartSharedFrameOutput(const char *name)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    if (!name)
+    {
+        return SMF_InvalidArgError("name");
+    }
+
+    if (g_header)
+    {
+        return SMF_SetError("shared frame output already started");
+    }
+
+    int w = 0;
+    int h = 0;
+    if (SDL_GetRendererOutputSize(SMF_GetRenderer(), &w, &h) == -1)
+    {
+        return SMF_SDLError();
+    }
+
+    size_t stride = (size_t)w * 4;
+    size_t slot_size = ALIGN_SIZE(stride * (size_t)h);
+    size_t header_size = ALIGN_SIZE(sizeof(SMF_SharedFrameHeader));
+    size_t size = header_size + slot_size * SMF_SHARED_FRAME_SLOTS;
+
+    size_t name_len = strlen(name);
+    g_name = SMF_Calloc(name_len + 1, 1);
+    if (!g_name)
+    {
+        return -1;
+    }
+
+    memcpy(g_name, name, name_len + 1);
+
+    if (OpenMapping(name, size) == -1)
+    {
+        SMF_Free(g_name);
+        g_name = NULL;
+        return -1;
+    }
+
+    g_header->version = SMF_SHARED_FRAME_VERSION;
+    g_header->width = (uint32_t)w;
+    g_header->height = (uint32_t)h;
+    g_header->stride = (uint32_t)stride;
+    g_header->format = SMF_SHARED_FRAME_FORMAT_BGRA;
+    for (int ix = 0; ix < SMF_SHARED_FRAME_SLOTS; ++ix)
+    {
+        g_header->slot_offset[ix] = header_size + slot_size * (size_t)ix;
+        g_header->slot_seq[ix] = 0;
+    }
+
+    // the producer starts with slot 0, slot 1 waits in the middle and the consumer starts out holding slot 2
+    g_header->seq = 0;
+    g_header->state = 1;
+    g_header->futex = 0;
+    g_header->is_active = 1;
+    g_back_slot = 0;
+    g_seq = 0;
+
+    // the magic goes last, a consumer that sees it can rely on the rest of the header
+    __atomic_store_n(&g_header->magic, SMF_SHARED_FRAME_MAGIC, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+int SMF_StopSharedFrameOutput(void)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    SMF_CleanSharedFrames();
+    return 0;
+}
+
+void SMF_CleanSharedFrames(void)
+{
+    if (!g_header)
+    {
+        return;
+    }
+
+    // let a waiting consumer know no more frames are coming
+    __atomic_store_n(&g_header->is_active, 0, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&g_header->futex, 1, __ATOMIC_RELEASE);
+    WakeConsumer();
+
+    CloseMapping();
+    SMF_Free(g_name);
+    g_header = NULL;
+    g_name = NULL;
+}
+
+#endif
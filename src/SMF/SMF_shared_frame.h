@@ -0,0 +1,7 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+void SMF_WriteSharedFrame(SDL_Renderer *renderer);
+void SMF_CleanSharedFrames(void);
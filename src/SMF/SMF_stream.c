@@ -0,0 +1,147 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <limits.h>
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_stream.h"
+
+#include "SMF_context.h"
+#include "SMF_mem.h"
+
+static Sint64 SDLCALL StreamSize(SDL_RWops *rw)
+{
+    SMF_Stream *stream = rw->hidden.unknown.data1;
+    if (!stream->size)
+    {
+        return -1;
+    }
+
+    return stream->size(stream->user);
+}
+
+static Sint64 SDLCALL StreamSeek(SDL_RWops *rw, Sint64 offset, int whence)
+{
+    SMF_Stream *stream = rw->hidden.unknown.data1;
+    return stream->seek(stream->user, offset, whence);
+}
+
+static size_t SDLCALL StreamRead(SDL_RWops *rw, void *ptr, size_t size, size_t maxnum)
+{
+    SMF_Stream *stream = rw->hidden.unknown.data1;
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    return stream->read(stream->user, ptr, size * maxnum) / size;
+}
+
+static size_t SDLCALL StreamWrite(SDL_RWops *rw, const void *ptr, size_t size, size_t num)
+{
+    SDL_SetError("stream is read-only");
+    return 0;
+}
+
+static int SDLCALL StreamClose(SDL_RWops *rw)
+{
+    SMF_Stream *stream = rw->hidden.unknown.data1;
+    if (stream->close)
+    {
+        stream->close(stream->user);
+    }
+
+    SMF_Free(stream);
+    SDL_FreeRW(rw);
+
+    return 0;
+}
+
+SDL_RWops *SMF_CreateMemoryRW(const void *data, size_t size)
+{
+    if (!data)
+    {
+        SMF_InvalidArgError("data");
+        return NULL;
+    }
+
+    if (size == 0 || size > INT_MAX)
+    {
+        SMF_InvalidArgError("size");
+        return NULL;
+    }
+
+    // the data is read in place, so nothing is copied but the caller has to keep it alive as long as the RWops
+    SDL_RWops *rw = SDL_RWFromConstMem(data, (int)size);
+    if (!rw)
+    {
+        SMF_SDLError();
+        return NULL;
+    }
+
+    return rw;
+}
+
+void SMF_CloseStream(const SMF_Stream *stream)
+{
+    if (stream && stream->close)
+    {
+        stream->close(stream->user);
+    }
+}
+
+SDL_RWops *SMF_CreateStreamRW(const SMF_Stream *stream)
+{
+    // the stream is handed over by the caller, so it is closed on every failure just as the RWops would close it
+    if (!stream)
+    {
+        SMF_InvalidArgError("stream");
+        return NULL;
+    }
+
+    if (!stream->seek)
+    {
+        SMF_CloseStream(stream);
+        SMF_InvalidArgError("stream->seek");
+        return NULL;
+    }
+
+    if (!stream->read)
+    {
+        SMF_CloseStream(stream);
+        SMF_InvalidArgError("stream->read");
+        return NULL;
+    }
+
+    SMF_Stream *copy = SMF_Calloc(1, sizeof(SMF_Stream));
+    if (!copy)
+    {
+        SMF_CloseStream(stream);
+        return NULL;
+    }
+
+    *copy = *stream;
+
+    SDL_RWops *rw = SDL_AllocRW();
+    if (!rw)
+    {
+        // the SDL error is kept before the callback gets a chance to replace it
+        SMF_SDLError();
+        SMF_Free(copy);
+        SMF_CloseStream(stream);
+        return NULL;
+    }
+
+    rw->size = StreamSize;
+    rw->seek = StreamSeek;
+    rw->read = StreamRead;
+    rw->write = StreamWrite;
+    rw->close = StreamClose;
+    rw->type = SDL_RWOPS_UNKNOWN;
+    rw->hidden.unknown.data1 = copy;
+
+    return rw;
+}
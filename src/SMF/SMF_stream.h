@@ -0,0 +1,8 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+SDL_RWops *SMF_CreateMemoryRW(const void *data, size_t size);
+SDL_RWops *SMF_CreateStreamRW(const SMF_Stream *stream);
+void SMF_CloseStream(const SMF_Stream *stream);
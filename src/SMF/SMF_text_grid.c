@@ -0,0 +1,523 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "SMF/SMF.h"
+
+#include "SMF_text_grid.h"
+
+#include "SMF_context.h"
+#include "SMF_handle_set.h"
+#include "SMF_image.h"
+#include "SMF_mem.h"
+#include "SMF_render.h"
+#include "SMF_utf8.h"
+#include "SMF_window.h"
+
+// marks a drawn cell whose pixels are unknown so that it is always redrawn
+#define STALE_GLYPH UINT32_MAX
+
+typedef struct SMF_TextCell
+{
+    uint32_t glyph;
+    SMF_Color fg;
+    SMF_Color bg;
+} SMF_TextCell;
+
+typedef struct SMF_TextGrid
+{
+    SMF_HandleObject base;
+    SMF_Handle font;
+    int cols;
+    int rows;
+    int cell_w;
+    int cell_h;
+    // the cells as set by the application and as last drawn into the texture
+    SMF_TextCell *cells;
+    SMF_TextCell *drawn;
+    uint8_t *dirty_rows;
+    // rows the texture still has to be scrolled by (positive moves the content up)
+    int pending_scroll;
+    SDL_Texture *texture;
+    SDL_Texture *back_texture;
+} SMF_TextGrid;
+
+static SMF_HandleSet g_text_grids;
+
+static void DestroyTextGrid(void *data)
+{
+    SMF_TextGrid *grid = (SMF_TextGrid *)data;
+    if (grid->texture)
+    {
+        SDL_DestroyTexture(grid->texture);
+    }
+    if (grid->back_texture)
+    {
+        SDL_DestroyTexture(grid->back_texture);
+    }
+    if (grid->cells)
+    {
+        SMF_TrackFree(SMF_MEMORY_TEXT_LAYOUTS, (size_t)grid->cols * grid->rows * sizeof(SMF_TextCell) * 2 + grid->rows);
+        SMF_Free(grid->cells);
+    }
+}
+
+int SMF_InitTextGrids(void)
+{
+    return SMF_InitHandleSet(&g_text_grids, SMF_HANDLE_TYPE_TEXT_GRID, sizeof(SMF_TextGrid), DestroyTextGrid);
+}
+
+void SMF_CleanTextGrids(void)
+{
+    SMF_CleanHandleSet(&g_text_grids);
+}
+
+static void FillCells(SMF_TextCell *cells, size_t count, uint32_t glyph, SMF_Color fg, SMF_Color bg)
+{
+    for (size_t ix = 0; ix < count; ++ix)
+    {
+        cells[ix].glyph = glyph;
+        cells[ix].fg = fg;
+        cells[ix].bg = bg;
+    }
+}
+
+void SMF_InvalidateTextGrids(void)
+{
+    // the textures keep their size but lost their pixels, so every cell is drawn again the next time
+    for (uint64_t ix = 0; ix < g_text_grids.data_len; ++ix)
+    {
+        SMF_TextGrid *grid = (SMF_TextGrid *)(g_text_grids.data + (ix * g_text_grids.data_size));
+        if (grid->base.handle != 0 && grid->cells)
+        {
+            size_t count = (size_t)grid->cols * grid->rows;
+            FillCells(grid->drawn, count, STALE_GLYPH, 0, 0);
+            memset(grid->dirty_rows, 1, grid->rows);
+            grid->pending_scroll = 0;
+        }
+    }
+}
+
+SMF_Handle SMF_CreateTextGrid(SMF_Handle font, int cols, int rows)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    if (cols <= 0)
+    {
+        SMF_InvalidArgError("cols");
+        return SMF_INVALID_HANDLE;
+    }
+
+    if (rows <= 0)
+    {
+        SMF_InvalidArgError("rows");
+        return SMF_INVALID_HANDLE;
+    }
+
+    int cell_h = SMF_GetFontHeight(font);
+    int is_fixed_width = SMF_IsFontFixedWidth(font);
+    if (cell_h == -1 || is_fixed_width == -1)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    // proportional fonts get cells as wide as their widest printable ASCII glyph
+    int cell_w = SMF_CalcTextWidth(font, "M");
+    for (char c = 32; !is_fixed_width && c < 127; ++c)
+    {
+        int w = SMF_CalcTextWidthN(font, &c, 1);
+        cell_w = w > cell_w ? w : cell_w;
+    }
+
+    if (cell_w <= 0 || cell_h <= 0)
+    {
+        SMF_SetError("font has no printable glyphs");
+        return SMF_INVALID_HANDLE;
+    }
+
+    if ((int64_t)cols * cell_w > INT16_MAX || (int64_t)rows * cell_h > INT16_MAX)
+    {
+        SMF_SetError("text grid is too large");
+        return SMF_INVALID_HANDLE;
+    }
+
+    size_t count = (size_t)cols * rows;
+    size_t size = count * sizeof(SMF_TextCell) * 2 + rows;
+
+    // both cell arrays and the dirty rows share one allocation
+    SMF_TextCell *cells = SMF_Calloc(1, size);
+    if (!cells)
+    {
+        return SMF_INVALID_HANDLE;
+    }
+
+    SMF_TextGrid *grid = SMF_CreateHandle(&g_text_grids);
+    if (!grid)
+    {
+        SMF_Free(cells);
+        return SMF_INVALID_HANDLE;
+    }
+
+    SMF_TrackAlloc(SMF_MEMORY_TEXT_LAYOUTS, size);
+
+    grid->font = font;
+    grid->cols = cols;
+    grid->rows = rows;
+    grid->cell_w = cell_w;
+    grid->cell_h = cell_h;
+    grid->cells = cells;
+    grid->drawn = cells + count;
+    grid->dirty_rows = (uint8_t *)(grid->drawn + count);
+
+    FillCells(grid->cells, count, ' ', SMF_RGB(255, 255, 255), SMF_RGBA(0, 0, 0, 0));
+    FillCells(grid->drawn, count, STALE_GLYPH, 0, 0);
+    memset(grid->dirty_rows, 1, rows);
+
+    return grid->base.handle;
+}
+
+int SMF_GetTextGridCellSize(SMF_Handle grid, int *w, int *h)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    SMF_TextGrid *data = SMF_FindHandleObject(&g_text_grids, grid);
+    if (!data)
+    {
+        return -1;
+    }
+
+    if (w)
+    {
+        *w = data->cell_w;
+    }
+
+    if (h)
+    {
+        *h = data->cell_h;
+    }
+
+    return 0;
+}
+
+int SMF_PutTextGridCell(SMF_Handle grid, int col, int row, uint32_t glyph, SMF_Color fg, SMF_Color bg)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    SMF_TextGrid *data = SMF_FindHandleObject(&g_text_grids, grid);
+    if (!data)
+    {
+        return -1;
+    }
+
+    if (col < 0 || col >= data->cols)
+    {
+        return SMF_InvalidArgError("col");
+    }
+
+    if (row < 0 || row >= data->rows)
+    {
+        return SMF_InvalidArgError("row");
+    }
+
+    SMF_TextCell *cell = data->cells + (size_t)row * data->cols + col;
+    cell->glyph = glyph;
+    cell->fg = fg;
+    cell->bg = bg;
+
+    data->dirty_rows[row] = 1;
+
+    return 0;
+}
+
+int SMF_PutTextGridString(SMF_Handle grid, int col, int row, const char *text, SMF_Color fg, SMF_Color bg)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (!text)
+    {
+        return SMF_InvalidArgError("text");
+    }
+
+    SMF_TextGrid *data = SMF_FindHandleObject(&g_text_grids, grid);
+    if (!data)
+    {
+        return -1;
+    }
+
+    if (col < 0 || col >= data->cols)
+    {
+        return SMF_InvalidArgError("col");
+    }
+
+    if (row < 0 || row >= data->rows)
+    {
+        return SMF_InvalidArgError("row");
+    }
+
+    // one glyph per cell, the text is cut off at the end of the row
+    SMF_TextCell *cell = data->cells + (size_t)row * data->cols + col;
+    SMF_TextCell *end = data->cells + (size_t)(row + 1) * data->cols;
+
+    size_t len = strlen(text);
+    size_t pos = 0;
+    while (pos < len && cell < end)
+    {
+        cell->glyph = SMF_DecodeUTF8(text, len, &pos);
+        cell->fg = fg;
+        cell->bg = bg;
+        cell++;
+    }
+
+    data->dirty_rows[row] = 1;
+
+    return 0;
+}
+
+int SMF_ClearTextGrid(SMF_Handle grid, SMF_Color bg)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    SMF_TextGrid *data = SMF_FindHandleObject(&g_text_grids, grid);
+    if (!data)
+    {
+        return -1;
+    }
+
+    FillCells(data->cells, (size_t)data->cols * data->rows, ' ', SMF_RGB(255, 255, 255), bg);
+    memset(data->dirty_rows, 1, data->rows);
+
+    return 0;
+}
+
+int SMF_ScrollTextGrid(SMF_Handle grid, int rows, SMF_Color bg)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    SMF_TextGrid *data = SMF_FindHandleObject(&g_text_grids, grid);
+    if (!data)
+    {
+        return -1;
+    }
+
+    if (rows == 0)
+    {
+        return 0;
+    }
+
+    size_t cols = data->cols;
+    int count = rows > 0 ? rows : -rows;
+    if (count >= data->rows)
+    {
+        return SMF_ClearTextGrid(grid, bg);
+    }
+
+    // the drawn cells move along with the texture, which is scrolled on the GPU the next time the grid is drawn
+    size_t kept = (size_t)(data->rows - count);
+    size_t src = rows > 0 ? (size_t)count : 0;
+    size_t dst = rows > 0 ? 0 : (size_t)count;
+    size_t exposed = rows > 0 ? kept : 0;
+
+    memmove(data->cells + dst * cols, data->cells + src * cols, kept * cols * sizeof(SMF_TextCell));
+    memmove(data->drawn + dst * cols, data->drawn + src * cols, kept * cols * sizeof(SMF_TextCell));
+    memmove(data->dirty_rows + dst, data->dirty_rows + src, kept);
+
+    FillCells(data->cells + exposed * cols, count * cols, ' ', SMF_RGB(255, 255, 255), bg);
+    FillCells(data->drawn + exposed * cols, count * cols, STALE_GLYPH, 0, 0);
+    memset(data->dirty_rows + exposed, 1, count);
+
+    data->pending_scroll += rows;
+
+    return 0;
+}
+
+int SMF_RenderTextGrid(SMF_Handle grid, int x, int y)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return -1;
+    }
+
+    if (SMF_IsWindowCreated() == -1)
+    {
+        return -1;
+    }
+
+    if (!SMF_FindHandleObject(&g_text_grids, grid))
+    {
+        return -1;
+    }
+
+    return SMF_PushTextGridCommand(grid, x, y);
+}
+
+void SMF_DestroyTextGrid(SMF_Handle grid)
+{
+    if (SMF_IsInitialized() == -1)
+    {
+        return;
+    }
+
+    SMF_DestroyHandle(&g_text_grids, grid);
+}
+
+static SDL_Texture *CreateGridTexture(SDL_Renderer *renderer, SMF_TextGrid *grid)
+{
+    SDL_Texture *texture = SDL_CreateTexture(renderer,
+                                             SDL_PIXELFORMAT_ARGB8888,
+                                             SDL_TEXTUREACCESS_TARGET,
+                                             grid->cols * grid->cell_w,
+                                             grid->rows * grid->cell_h);
+    if (texture)
+    {
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    }
+
+    return texture;
+}
+
+static void ScrollTexture(SDL_Renderer *renderer, SMF_TextGrid *grid)
+{
+    int rows = grid->pending_scroll;
+    int count = rows > 0 ? rows : -rows;
+    grid->pending_scroll = 0;
+
+    // the cells that come into view were marked stale when scrolling, so only the kept part is copied over
+    int kept_h = (grid->rows - count) * grid->cell_h;
+    if (kept_h <= 0)
+    {
+        return;
+    }
+
+    int w = grid->cols * grid->cell_w;
+    int shift = count * grid->cell_h;
+    SDL_Rect src = {0, rows > 0 ? shift : 0, w, kept_h};
+    SDL_Rect dst = {0, rows > 0 ? 0 : shift, w, kept_h};
+
+    SDL_SetRenderTarget(renderer, grid->back_texture);
+    SDL_SetTextureBlendMode(grid->texture, SDL_BLENDMODE_NONE);
+    SDL_SetTextureColorMod(grid->texture, 255, 255, 255);
+    SDL_SetTextureAlphaMod(grid->texture, 255);
+    SDL_RenderCopy(renderer, grid->texture, &src, &dst);
+    SDL_SetTextureBlendMode(grid->texture, SDL_BLENDMODE_BLEND);
+
+    SDL_Texture *texture = grid->texture;
+    grid->texture = grid->back_texture;
+    grid->back_texture = texture;
+}
+
+static void DrawCell(SDL_Renderer *renderer, SMF_TextGrid *grid, const SMF_TextCell *cell, int x, int y)
+{
+    SDL_Rect rect = {x, y, grid->cell_w, grid->cell_h};
+
+    // the background replaces the previous pixels of the cell, alpha included
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, SMF_RED(cell->bg), SMF_GREEN(cell->bg), SMF_BLUE(cell->bg), SMF_ALPHA(cell->bg));
+    SDL_RenderFillRect(renderer, &rect);
+
+    if (cell->glyph == ' ')
+    {
+        return;
+    }
+
+    SMF_Handle image = SMF_GetFontGlyphImage(grid->font, cell->glyph);
+    if (image == SMF_INVALID_HANDLE)
+    {
+        return;
+    }
+
+    int w = 0;
+    int h = 0;
+    SDL_Texture *texture = SMF_GetImageTexture(image, &w, &h);
+    if (!texture)
+    {
+        return;
+    }
+
+    // glyphs wider or taller than the cell are cut off so they never bleed into their neighbours
+    SDL_Rect src = {0, 0, w < grid->cell_w ? w : grid->cell_w, h < grid->cell_h ? h : grid->cell_h};
+    SDL_Rect dst = {x, y, src.w, src.h};
+
+    // glyph textures are shared with image commands, which may have left another blend mode on them
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureColorMod(texture, SMF_RED(cell->fg), SMF_GREEN(cell->fg), SMF_BLUE(cell->fg));
+    SDL_SetTextureAlphaMod(texture, SMF_ALPHA(cell->fg));
+    SDL_RenderCopy(renderer, texture, &src, &dst);
+}
+
+void SMF_DrawTextGrid(SDL_Renderer *renderer, SMF_Handle grid, int x, int y)
+{
+    SMF_TextGrid *data = SMF_FindHandleObject(&g_text_grids, grid);
+    if (!data)
+    {
+        return;
+    }
+
+    if (!data->texture)
+    {
+        data->texture = CreateGridTexture(renderer, data);
+        data->back_texture = CreateGridTexture(renderer, data);
+        if (!data->texture || !data->back_texture)
+        {
+            SMF_SDLError();
+            return;
+        }
+    }
+
+    SDL_Texture *prev_target = SDL_GetRenderTarget(renderer);
+
+    if (data->pending_scroll != 0)
+    {
+        ScrollTexture(renderer, data);
+    }
+
+    SDL_SetRenderTarget(renderer, data->texture);
+
+    size_t cols = data->cols;
+    for (int row = 0; row < data->rows; ++row)
+    {
+        if (!data->dirty_rows[row])
+        {
+            continue;
+        }
+
+        data->dirty_rows[row] = 0;
+
+        SMF_TextCell *cells = data->cells + row * cols;
+        SMF_TextCell *drawn = data->drawn + row * cols;
+        for (size_t col = 0; col < cols; ++col)
+        {
+            if (memcmp(cells + col, drawn + col, sizeof(SMF_TextCell)) != 0)
+            {
+                DrawCell(renderer, data, cells + col, (int)col * data->cell_w, row * data->cell_h);
+                drawn[col] = cells[col];
+            }
+        }
+    }
+
+    SDL_SetRenderTarget(renderer, prev_target);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    SDL_Rect dst = {x, y, data->cols * data->cell_w, data->rows * data->cell_h};
+    SDL_RenderCopy(renderer, data->texture, NULL, &dst);
+}
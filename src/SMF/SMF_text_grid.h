@@ -0,0 +1,9 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+int SMF_InitTextGrids(void);
+void SMF_CleanTextGrids(void);
+void SMF_InvalidateTextGrids(void);
+void SMF_DrawTextGrid(SDL_Renderer *renderer, SMF_Handle grid, int x, int y);
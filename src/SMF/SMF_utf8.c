@@ -0,0 +1,160 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <string.h>
+
+#include "SMF_utf8.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SMF_UTF8_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SMF_UTF8_NEON
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(SMF_UTF8_SSE2)
+static size_t CountTrailingZeros(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long ix = 0;
+    _BitScanForward(&ix, mask);
+    return ix;
+#else
+    return (size_t)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+size_t SMF_CountASCII(const char *text, size_t len)
+{
+    const uint8_t *bytes = (const uint8_t *)text;
+    size_t ix = 0;
+
+#if defined(SMF_UTF8_SSE2)
+    for (; ix + 32 <= len; ix += 32)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(bytes + ix));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(bytes + ix + 16));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(lo) | ((uint32_t)_mm_movemask_epi8(hi) << 16);
+        if (mask != 0)
+        {
+            return ix + CountTrailingZeros(mask);
+        }
+    }
+
+    for (; ix + 16 <= len; ix += 16)
+    {
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(bytes + ix)));
+        if (mask != 0)
+        {
+            return ix + CountTrailingZeros(mask);
+        }
+    }
+#elif defined(SMF_UTF8_NEON)
+    for (; ix + 32 <= len; ix += 32)
+    {
+        uint8x16_t lo = vld1q_u8(bytes + ix);
+        uint8x16_t hi = vld1q_u8(bytes + ix + 16);
+        if (vmaxvq_u8(vorrq_u8(lo, hi)) >= 0x80)
+        {
+            break;
+        }
+    }
+
+    for (; ix + 16 <= len; ix += 16)
+    {
+        if (vmaxvq_u8(vld1q_u8(bytes + ix)) >= 0x80)
+        {
+            break;
+        }
+    }
+#else
+    for (; ix + 8 <= len; ix += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + ix, sizeof(word));
+        if ((word & 0x8080808080808080ull) != 0)
+        {
+            break;
+        }
+    }
+#endif
+
+    while (ix < len && bytes[ix] < 0x80)
+    {
+        ix++;
+    }
+
+    return ix;
+}
+
+uint32_t SMF_DecodeUTF8(const char *text, size_t len, size_t *pos)
+{
+    const uint8_t *bytes = (const uint8_t *)text + *pos;
+    size_t avail = len - *pos;
+
+    uint32_t c = bytes[0];
+    if (c < 0x80)
+    {
+        *pos += 1;
+        return c;
+    }
+
+    size_t count = 0;
+    uint32_t min = 0;
+    if ((c & 0xe0) == 0xc0)
+    {
+        count = 2;
+        min = 0x80;
+        c &= 0x1f;
+    }
+    else if ((c & 0xf0) == 0xe0)
+    {
+        count = 3;
+        min = 0x800;
+        c &= 0x0f;
+    }
+    else if ((c & 0xf8) == 0xf0)
+    {
+        count = 4;
+        min = 0x10000;
+        c &= 0x07;
+    }
+    else
+    {
+        *pos += 1;
+        return SMF_REPLACEMENT_CHARACTER;
+    }
+
+    if (count > avail)
+    {
+        *pos += 1;
+        return SMF_REPLACEMENT_CHARACTER;
+    }
+
+    for (size_t ix = 1; ix < count; ++ix)
+    {
+        if ((bytes[ix] & 0xc0) != 0x80)
+        {
+            *pos += 1;
+            return SMF_REPLACEMENT_CHARACTER;
+        }
+
+        c = (c << 6) | (bytes[ix] & 0x3f);
+    }
+
+    // reject overlong encodings, surrogates and anything beyond the unicode range
+    if (c < min || (c >= 0xd800 && c <= 0xdfff) || c > 0x10ffff)
+    {
+        *pos += 1;
+        return SMF_REPLACEMENT_CHARACTER;
+    }
+
+    *pos += count;
+    return c;
+}
@@ -0,0 +1,12 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SMF_REPLACEMENT_CHARACTER 0xfffd
+
+size_t SMF_CountASCII(const char *text, size_t len);
+uint32_t SMF_DecodeUTF8(const char *text, size_t len, size_t *pos);
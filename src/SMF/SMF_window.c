@@ -6,6 +6,7 @@
 #include "SMF/SMF.h"
 
 #include "SMF_context.h"
+#include "SMF_replay.h"
 
 #define SMF_WINDOW_TITLE_BUFFER_SIZE 256
 
@@ -120,7 +121,9 @@ int SMF_CreateWindow(void)
         return SMF_SDLError();
     }
 
-    g_renderer = SDL_CreateRenderer(g_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+    // the dummy video driver used by replays only has the software renderer
+    Uint32 flags = SMF_IsReplaying() ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED;
+    g_renderer = SDL_CreateRenderer(g_window, -1, flags | SDL_RENDERER_TARGETTEXTURE);
     if (!g_renderer)
     {
         SMF_SDLError();
@@ -151,3 +154,8 @@ int SMF_GetWindowScale(void)
 {
     return g_window_scale;
 }
+
+SDL_Renderer *SMF_GetRenderer(void)
+{
+    return g_renderer;
+}
@@ -8,3 +8,5 @@ void SMF_CleanupWindow(void);
 int SMF_IsWindowCreated(void);
 
 int SMF_GetWindowScale(void);
+
+SDL_Renderer *SMF_GetRenderer(void);
@@ -0,0 +1,187 @@
+// Copyright (c) 2024-present, Jason Hoyt
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+// Reference consumer for SMF_StartSharedFrameOutput: maps the frames without copying them, checks that every frame it
+// takes stays intact while it reads it and reports how many frames arrive per second. It fails when a frame is torn or
+// when more frames than the allowed slack are skipped (a tenth of the published frames unless given).
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <SMF/SMF.h>
+
+static uint64_t GetMilliseconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void WaitForFrame(SMF_SharedFrameHeader *header, uint32_t seen)
+{
+#if defined(__linux__)
+    struct timespec timeout = {0, 100 * 1000 * 1000};
+    syscall(SYS_futex, &header->futex, FUTEX_WAIT, seen, &timeout, NULL, 0);
+#else
+    while (__atomic_load_n(&header->futex, __ATOMIC_ACQUIRE) == seen)
+    {
+        usleep(1000);
+    }
+#endif
+}
+
+static uint64_t HashFrame(const uint8_t *pixels, const SMF_SharedFrameHeader *header)
+{
+    // FNV-1a over whole pixels, good enough to tell if the frame changed underneath us
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint32_t y = 0; y < header->height; ++y)
+    {
+        const uint32_t *row = (const uint32_t *)(pixels + (size_t)y * header->stride);
+        for (uint32_t x = 0; x < header->width; ++x)
+        {
+            hash = (hash ^ row[x]) * 0x100000001b3ull;
+        }
+    }
+
+    return hash;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <shared memory name> [seconds] [skipped frame slack]\n", argv[0]);
+        return 2;
+    }
+
+    const char *name = argv[1];
+    int seconds = argc > 2 ? atoi(argv[2]) : 10;
+    long long slack = argc > 3 ? atoll(argv[3]) : -1;
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd == -1)
+    {
+        fprintf(stderr, "error: failed to open shared memory '%s'\n", name);
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(SMF_SharedFrameHeader))
+    {
+        fprintf(stderr, "error: shared memory '%s' is too small\n", name);
+        close(fd);
+        return 1;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "error: failed to map shared memory '%s'\n", name);
+        return 1;
+    }
+
+    SMF_SharedFrameHeader *header = data;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SMF_SHARED_FRAME_MAGIC ||
+        header->version != SMF_SHARED_FRAME_VERSION || header->format != SMF_SHARED_FRAME_FORMAT_BGRA)
+    {
+        fprintf(stderr, "error: '%s' does not hold SMF frames\n", name);
+        return 1;
+    }
+
+    printf("%ux%u BGRA, stride %u\n", header->width, header->height, header->stride);
+
+    uint32_t slot = 2;
+    uint64_t last_seq = 0;
+    uint64_t received = 0;
+    uint64_t skipped = 0;
+    uint64_t torn = 0;
+    uint64_t window_received = 0;
+    uint64_t start_seq = __atomic_load_n(&header->seq, __ATOMIC_ACQUIRE);
+    uint64_t window_seq = start_seq;
+    uint64_t start = GetMilliseconds();
+    uint64_t window_start = start;
+
+    while (GetMilliseconds() - start < (uint64_t)seconds * 1000)
+    {
+        uint32_t seen = __atomic_load_n(&header->futex, __ATOMIC_ACQUIRE);
+        if (!__atomic_load_n(&header->is_active, __ATOMIC_ACQUIRE))
+        {
+            printf("producer stopped\n");
+            break;
+        }
+
+        if ((__atomic_load_n(&header->state, __ATOMIC_ACQUIRE) & SMF_SHARED_FRAME_FRESH) == 0)
+        {
+            WaitForFrame(header, seen);
+            continue;
+        }
+
+        uint32_t prev = __atomic_exchange_n(&header->state, slot, __ATOMIC_ACQ_REL);
+        slot = prev & SMF_SHARED_FRAME_SLOT_MASK;
+
+        const uint8_t *pixels = (const uint8_t *)data + header->slot_offset[slot];
+        uint64_t seq = __atomic_load_n(&header->slot_seq[slot], __ATOMIC_ACQUIRE);
+
+        // the producer must not touch the slot while it is ours, so hashing it twice gives the same result
+        uint64_t hash = HashFrame(pixels, header);
+        if (HashFrame(pixels, header) != hash || __atomic_load_n(&header->slot_seq[slot], __ATOMIC_ACQUIRE) != seq)
+        {
+            torn++;
+        }
+
+        if (seq <= last_seq)
+        {
+            fprintf(stderr, "error: frame %llu arrived after frame %llu\n",
+                    (unsigned long long)seq, (unsigned long long)last_seq);
+            torn++;
+        }
+        else if (last_seq != 0)
+        {
+            skipped += seq - last_seq - 1;
+        }
+
+        last_seq = seq;
+        received++;
+        window_received++;
+
+        uint64_t now = GetMilliseconds();
+        if (now - window_start >= 1000)
+        {
+            uint64_t published = __atomic_load_n(&header->seq, __ATOMIC_ACQUIRE) - window_seq;
+            printf("received %llu of %llu frames in %llu ms\n",
+                   (unsigned long long)window_received,
+                   (unsigned long long)published,
+                   (unsigned long long)(now - window_start));
+            window_received = 0;
+            window_seq += published;
+            window_start = now;
+        }
+    }
+
+    uint64_t published = __atomic_load_n(&header->seq, __ATOMIC_ACQUIRE) - start_seq;
+    printf("received %llu of %llu frames, skipped %llu, torn %llu\n", (unsigned long long)received,
+           (unsigned long long)published, (unsigned long long)skipped, (unsigned long long)torn);
+
+    munmap(data, (size_t)st.st_size);
+
+    uint64_t allowed = slack < 0 ? published / 10 : (uint64_t)slack;
+    if (received + allowed < published)
+    {
+        fprintf(stderr, "error: received %llu of %llu frames, more than %llu were skipped\n",
+                (unsigned long long)received, (unsigned long long)published, (unsigned long long)allowed);
+        return 1;
+    }
+
+    return torn == 0 ? 0 : 1;
+}
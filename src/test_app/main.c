@@ -46,6 +46,11 @@ int main(void)
             }
         }
 
+        SMF_RenderImage(image, 10, 10);
+        SMF_SetRenderColor(SMF_RGB(255, 255, 0));
+        SMF_RenderText(font, "Hello, World!", 10, 200);
+        SMF_RenderPresent();
+
         SMF_Sleep(25);
     }
 